@@ -0,0 +1,82 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#define ARENA_DEFAULT_BLOCK_BYTENUM (64 * 1024)
+#define ARENA_MIN_BLOCK_BYTENUM (4 * 1024)
+#define ARENA_ALIGN_BYTENUM 8
+
+// Arena - bump allocator for memtable nodes
+// 所有内存随Arena析构一次性释放，不支持单独free
+// allocate()可被多个线程并发调用: 常规路径只有一次fetch_add，
+// 仅在当前block用尽时才加锁换新block
+class Arena {
+   private:
+    struct BlockProps {
+        char *base;
+        size_t size;
+        std::atomic<size_t> used;
+        BlockProps(char *_base, size_t _size)
+            : base(_base), size(_size), used(0) {}
+    };
+    size_t blockBytes;
+    std::atomic<BlockProps *> curBlock;
+    std::atomic<size_t> usage;
+    std::mutex blockMutex;  // 保护blocks
+    std::vector<BlockProps *> blocks;
+
+    BlockProps *allocNewBlock(size_t bytes) {
+        BlockProps *block = new BlockProps(new char[bytes], bytes);
+        blocks.push_back(block);
+        usage.fetch_add(bytes + sizeof(BlockProps), std::memory_order_relaxed);
+        return block;
+    }
+
+   public:
+    explicit Arena(size_t _blockBytes = ARENA_DEFAULT_BLOCK_BYTENUM)
+        : blockBytes(_blockBytes), usage(0) {
+        curBlock.store(allocNewBlock(blockBytes), std::memory_order_release);
+    }
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+    ~Arena() {
+        for (BlockProps *block : blocks) {
+            delete[] block->base;
+            delete block;
+        }
+    }
+    // allocate - 返回按ARENA_ALIGN_BYTENUM对齐的内存
+    char *allocate(size_t bytes) {
+        // 所有分配都向上取整到对齐粒度，block内偏移因此始终对齐
+        bytes = (bytes + ARENA_ALIGN_BYTENUM - 1) & ~(ARENA_ALIGN_BYTENUM - 1);
+        if (bytes > blockBytes / 4) {
+            // 大对象单独分配一个block，避免浪费当前block的剩余空间
+            std::lock_guard<std::mutex> lock(blockMutex);
+            BlockProps *block = allocNewBlock(bytes);
+            block->used.store(bytes, std::memory_order_relaxed);
+            return block->base;
+        }
+        while (true) {
+            BlockProps *block = curBlock.load(std::memory_order_acquire);
+            size_t offset =
+                block->used.fetch_add(bytes, std::memory_order_relaxed);
+            if (offset + bytes <= block->size) return block->base + offset;
+            // 当前block已满，由一个线程换上新block，其余线程重试
+            std::lock_guard<std::mutex> lock(blockMutex);
+            if (curBlock.load(std::memory_order_relaxed) == block)
+                curBlock.store(allocNewBlock(blockBytes),
+                               std::memory_order_release);
+        }
+    }
+    // memoryUsage - arena向系统申请的总字节数
+    size_t memoryUsage() const {
+        return usage.load(std::memory_order_relaxed);
+    }
+};
+
+#endif  // ARENA_H
@@ -0,0 +1,185 @@
+#include "arena_skiplist.h"
+
+#include <new>
+#include <optional>
+#include <random>
+
+namespace skiplist {
+// 每个线程独立的xorshift状态，randomLevel不再争用全局rand()
+static thread_local uint64_t levelRngState = std::random_device{}() | 1;
+
+int arena_skiplist_type::randomLevel() {
+    int lv = 0;
+    // use bitwise operation to accelerate float comparison
+    const uint64_t threshold = uint64_t(0xFFFF * p);
+    while (true) {
+        levelRngState ^= levelRngState << 13;
+        levelRngState ^= levelRngState >> 7;
+        levelRngState ^= levelRngState << 17;
+        if ((levelRngState & 0xFFFF) >= threshold) break;
+        ++lv;
+    }
+    return std::min(MAXLV, lv);
+}
+arena_skiplist_type::arena_skiplist_type(size_t arenaBlockBytes, double p)
+    : arena(arenaBlockBytes), level(0), length(0), p(p) {
+    head = newNode(0, MAXLV + 1, VlogPointer{0, 0});
+    for (int i = 0; i <= MAXLV; i++)
+        finger[i].store(nullptr, std::memory_order_relaxed);
+}
+const VlogPointer *arena_skiplist_type::newValue(const VlogPointer &val) {
+    char *mem = arena.allocate(sizeof(VlogPointer));
+    return new (mem) VlogPointer(val);
+}
+void arena_skiplist_type::replaceValue(ArenaNode *node,
+                                       const VlogPointer *val) {
+    const VlogPointer *cur = node->value.load(std::memory_order_acquire);
+    // 旧记录留在arena中，随flush一起释放
+    while (cur->offset < val->offset &&
+           !node->value.compare_exchange_weak(cur, val,
+                                              std::memory_order_acq_rel))
+        ;
+}
+ArenaNode *arena_skiplist_type::newNode(key_type key, int height,
+                                        const VlogPointer &val) {
+    // key与value放在同一次分配里，相邻存储
+    size_t nodeBytes = sizeof(ArenaNode) +
+                       sizeof(std::atomic<ArenaNode *>) * (height - 1);
+    nodeBytes = (nodeBytes + ARENA_ALIGN_BYTENUM - 1) &
+                ~size_t(ARENA_ALIGN_BYTENUM - 1);
+    char *mem = arena.allocate(nodeBytes + sizeof(VlogPointer));
+    ArenaNode *node = new (mem) ArenaNode;
+    node->key = key;
+    node->height = height;
+    node->value.store(new (mem + nodeBytes) VlogPointer(val),
+                      std::memory_order_relaxed);
+    for (int i = 0; i < height; i++)
+        new (&node->forward[i]) std::atomic<ArenaNode *>(nullptr);
+    return node;
+}
+void arena_skiplist_type::findSpliceForLevel(key_type key, ArenaNode *before,
+                                             int i, ArenaNode **prev,
+                                             ArenaNode **next) const {
+    ArenaNode *x = before->next(i);
+    while (x && x->key < key) {
+        before = x;
+        x = x->next(i);
+    }
+    *prev = before;
+    *next = x;
+}
+void arena_skiplist_type::advanceFinger(int i, ArenaNode *node) {
+    ArenaNode *cur = finger[i].load(std::memory_order_acquire);
+    while ((!cur || cur->key < node->key) &&
+           !finger[i].compare_exchange_weak(cur, node,
+                                            std::memory_order_acq_rel))
+        ;
+}
+void arena_skiplist_type::put(key_type key, const VlogPointer &val) {
+    ArenaNode *prev[MAXLV + 1];
+    ArenaNode *next[MAXLV + 1];
+    int curLevel = level.load(std::memory_order_acquire);
+    int lv = randomLevel();
+    ArenaNode *last = finger[0].load(std::memory_order_acquire);
+    if (last && last->key < key) {
+        // 追加: key大于表中所有key，只需定位新节点所在的各层，
+        // 每层从finger出发，期望O(1)步即到达末尾
+        for (int i = 0; i <= std::min(lv, curLevel); i++) {
+            ArenaNode *f = finger[i].load(std::memory_order_acquire);
+            findSpliceForLevel(key, f && f->key < key ? f : head, i, &prev[i],
+                               &next[i]);
+        }
+    } else {
+        ArenaNode *p = head;
+        for (int i = curLevel; i >= 0; i--) {
+            findSpliceForLevel(key, p, i, &prev[i], &next[i]);
+            p = prev[i];
+        }
+    }
+    if (next[0] && next[0]->key == key) {
+        replaceValue(next[0], newValue(val));
+        return;
+    }
+
+    if (lv > curLevel) {
+        lv = curLevel + 1;
+        // 多个线程可能同时抬高level，用CAS取最大值
+        int observed = curLevel;
+        while (observed < lv &&
+               !level.compare_exchange_weak(observed, lv,
+                                            std::memory_order_acq_rel))
+            ;
+        findSpliceForLevel(key, head, lv, &prev[lv], &next[lv]);
+    }
+    ArenaNode *node = newNode(key, lv + 1, val);
+    for (int i = 0; i <= lv; i++) {
+        while (true) {
+            node->forward[i].store(next[i], std::memory_order_relaxed);
+            if (prev[i]->forward[i].compare_exchange_strong(
+                    next[i], node, std::memory_order_release)) {
+                advanceFinger(i, node);
+                break;
+            }
+            // CAS失败说明有并发插入，从原前驱重新定位本层位置
+            findSpliceForLevel(key, prev[i], i, &prev[i], &next[i]);
+            if (i == 0 && next[0] && next[0]->key == key) {
+                // 另一线程抢先插入了相同key，改为覆盖其value
+                replaceValue(next[0],
+                             node->value.load(std::memory_order_relaxed));
+                return;
+            }
+        }
+    }
+    length.fetch_add(1, std::memory_order_relaxed);
+}
+std::optional<VlogPointer> arena_skiplist_type::get(key_type key) const {
+    ArenaNode *p = head;
+    for (int i = level.load(std::memory_order_acquire); i >= 0; i--) {
+        ArenaNode *x = p->next(i);
+        while (x && x->key < key) {
+            p = x;
+            x = x->next(i);
+        }
+        if (x && x->key == key) {
+            return *x->value.load(std::memory_order_acquire);
+        }
+    }
+    return std::nullopt;
+}
+void arena_skiplist_type::scan(
+    uint64_t key1, uint64_t key2,
+    std::list<std::pair<uint64_t, VlogPointer>> &list) {
+    ArenaNode *p = head;
+    for (int i = level.load(std::memory_order_acquire); i >= 0; i--) {
+        ArenaNode *x = p->next(i);
+        while (x && x->key < key1) {
+            p = x;
+            x = x->next(i);
+        }
+    }
+    ArenaNode *res = p->next(0);
+    while (res && res->key <= key2) {
+        list.emplace_back(res->key, *res->value.load(std::memory_order_acquire));
+        res = res->next(0);
+    }
+}
+// ArenaIterator - 沿第0层链表前进
+class ArenaIterator : public memtable_type::Iterator {
+   private:
+    const ArenaNode *node;
+
+   public:
+    explicit ArenaIterator(const ArenaNode *first) : node(first) {}
+    bool valid() const override { return node != nullptr; }
+    void next() override { node = node->next(0); }
+    key_type key() const override { return node->key; }
+    VlogPointer value() const override {
+        return *node->value.load(std::memory_order_acquire);
+    }
+};
+std::unique_ptr<memtable_type::Iterator> arena_skiplist_type::newIterator()
+    const {
+    return std::make_unique<ArenaIterator>(head->next(0));
+}
+
+}  // namespace skiplist
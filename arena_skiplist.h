@@ -0,0 +1,69 @@
+#ifndef ARENA_SKIPLIST_H
+#define ARENA_SKIPLIST_H
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <optional>
+#include <string>
+
+#include "arena.h"
+#include "memtable.h"
+
+namespace skiplist {
+
+// ArenaNode - 变长节点，forward数组只有height个指针
+// 内存布局: [key|value|height|forward[0..height-1]][VlogPointer]
+// 覆盖写时整体替换value指向的VlogPointer记录
+struct ArenaNode {
+    key_type key;
+    std::atomic<const VlogPointer *> value;
+    int height;
+    std::atomic<ArenaNode *> forward[1];  // 实际长度为height
+
+    ArenaNode *next(int i) const {
+        return forward[i].load(std::memory_order_acquire);
+    }
+};
+
+// arena_skiplist_type - 并发skiplist，value本体已写入vlog，这里只存其位置
+// 写者之间无锁: 新节点自底向上逐层CAS进forward指针
+// 读者wait-free: 只做acquire load，节点一旦插入便不会被移除
+// 同一key并发覆盖时以offset较大(较晚写入vlog)者为准
+class arena_skiplist_type : public memtable_type {
+   private:
+    Arena arena;
+    ArenaNode *head = nullptr;
+    std::atomic<int> level, length;
+    double p;
+    // finger[i] - 第i层上key最大的节点，key递增写入时即为本层前驱
+    std::atomic<ArenaNode *> finger[MAXLV + 1];
+
+    ArenaNode *newNode(key_type key, int height, const VlogPointer &val);
+    const VlogPointer *newValue(const VlogPointer &val);
+    void replaceValue(ArenaNode *node, const VlogPointer *val);
+    // 在第i层从before开始寻找key的前驱/后继
+    void findSpliceForLevel(key_type key, ArenaNode *before, int i,
+                            ArenaNode **prev, ArenaNode **next) const;
+    void advanceFinger(int i, ArenaNode *node);
+
+   public:
+    int getLength() override {
+        return length.load(std::memory_order_relaxed);
+    }
+    int randomLevel();
+    explicit arena_skiplist_type(
+        size_t arenaBlockBytes = ARENA_DEFAULT_BLOCK_BYTENUM, double p = 0.25);
+    // 节点全部位于arena中，析构时随arena整体释放
+    ~arena_skiplist_type() override = default;
+    void put(key_type key, const VlogPointer &val) override;
+    std::optional<VlogPointer> get(key_type key) const override;
+    void scan(uint64_t key1, uint64_t key2,
+              std::list<std::pair<uint64_t, VlogPointer>> &list) override;
+    std::unique_ptr<Iterator> newIterator() const override;
+    size_t memoryUsage() const override { return arena.memoryUsage(); }
+};
+
+}  // namespace skiplist
+
+#endif  // ARENA_SKIPLIST_H
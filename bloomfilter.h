@@ -1,59 +1,273 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <vector>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
 
 #include "MurmurHash3.h"
 #include "type.h"
 
+// BF - 按bit紧凑存放的bloom filter
+// 每个key只算一次128位MurmurHash，拆成h1/h2，
+// 第i次探测取 h1 + i * h2 映射到[0, m) (Kirsch-Mitzenmacher double hashing)
 class BF {
    public:
-    int m;           // 哈希bit数组的大小
-    int k;           // 哈希函数的个数
-    bool* bitArray;  // 哈希bit数组
-    BF(int _m = DEFAULT_M_VAL, int _k = DEFAULT_HASHFUN_NUM) : m(_m), k(_k) {
-        bitArray = new bool[m];
-        for (int i = 0; i < m; i++) {
-            bitArray[i] = false;
+    uint32_t m;                      // bit数，BF_WORD_BITNUM的整数倍
+    uint32_t k;                      // 探测次数
+    std::vector<uint64_t> bitArray;  // m / 64 个word，构建时使用
+    // 从sst读出时直接指向映射中的bitArray，不拷贝; 映射须比filter活得久
+    const uint8_t* view = nullptr;
+    // 空filter: 不含任何信息，query总是返回true
+    BF() : m(0), k(0) {}
+    // 按keyNum * bitsPerKey分配bit数，k取最优值 bitsPerKey * ln2
+    BF(size_t keyNum, double bitsPerKey) {
+        size_t bits = size_t(std::ceil(keyNum * bitsPerKey));
+        bits = std::max<size_t>(bits, BF_WORD_BITNUM);
+        m = (bits + BF_WORD_BITNUM - 1) / BF_WORD_BITNUM * BF_WORD_BITNUM;
+        k = std::clamp<uint32_t>(uint32_t(std::lround(bitsPerKey * 0.69)), 1,
+                                 BF_MAX_HASHFUN_NUM);
+        bitArray.assign(m / BF_WORD_BITNUM, 0);
+    }
+    static void getHashValue(const uint64_t& key, uint64_t& h1, uint64_t& h2) {
+        uint64_t hashRes[2];
+        MurmurHash3_x64_128(&key, sizeof(key), 1, hashRes);
+        h1 = hashRes[0];
+        h2 = hashRes[1];
+    }
+    // bitPos - 取h的高32位映射到[0, m)，用乘法代替取模
+    uint32_t bitPos(uint64_t h) const {
+        return uint32_t(((h >> 32) * uint64_t(m)) >> 32);
+    }
+    void insert(const uint64_t& key) {
+        uint64_t h1, h2;
+        getHashValue(key, h1, h2);
+        uint64_t* words = bitArray.data();
+        for (uint32_t i = 0; i < k; i++, h1 += h2) {
+            uint32_t pos = bitPos(h1);
+            words[pos / BF_WORD_BITNUM] |= uint64_t(1) << (pos % BF_WORD_BITNUM);
+        }
+    }
+    // bytes - word按小端存放，第pos位即第pos/8字节的第pos%8位，
+    // 按字节访问时映射中的bitArray不必对齐
+    const uint8_t* bytes() const {
+        return view ? view : reinterpret_cast<const uint8_t*>(bitArray.data());
+    }
+    bool query(const uint64_t& key) const {
+        if (!m) return true;
+        uint64_t h1, h2;
+        getHashValue(key, h1, h2);
+        const uint8_t* bits = bytes();
+        // 负查询约一半在第一次探测就命中0，分支难以预测;
+        // filter很小、常驻cache，不提前退出反而更快
+        uint32_t hit = 1;
+        for (uint32_t i = 0; i < k; i++, h1 += h2) {
+            uint32_t pos = bitPos(h1);
+            hit &= bits[pos / 8] >> (pos % 8);
         }
+        return hit & 1;
     }
-    BF(const BF& other) : m(other.m), k(other.k) {
-        bitArray = new bool[m];
-        for (int i = 0; i < m; i++) {
-            bitArray[i] = other.bitArray[i];
+    // byteNum - bitArray在sst中占用的字节数
+    size_t byteNum() const { return m / 8; }
+    // sst中的格式: [m(u32)|k(u32)|bitArray]
+    void writeTo(std::ostream& out) const {
+        out.write(reinterpret_cast<const char*>(&m), sizeof(m));
+        out.write(reinterpret_cast<const char*>(&k), sizeof(k));
+        out.write(reinterpret_cast<const char*>(bytes()), byteNum());
+    }
+    // viewFrom - 在p处最多availBytes字节内解析，bitArray不拷贝;
+    // 返回占用的字节数，格式不合法时返回0
+    size_t viewFrom(const char* p, size_t availBytes) {
+        if (availBytes < sizeof(m) + sizeof(k)) return 0;
+        std::memcpy(&m, p, sizeof(m));
+        std::memcpy(&k, p + sizeof(m), sizeof(k));
+        size_t bytesNum = sizeof(m) + sizeof(k) + byteNum();
+        if (m % BF_WORD_BITNUM || k > BF_MAX_HASHFUN_NUM ||
+            bytesNum > availBytes) {
+            m = k = 0;
+            return 0;
         }
+        bitArray.clear();
+        view = reinterpret_cast<const uint8_t*>(p + sizeof(m) + sizeof(k));
+        return bytesNum;
+    }
+};
+
+// LegacyBF - 旧格式sst中固定LEGACY_BF_BITNUM位的bloom filter，只读
+// 第i位存放在第i/8字节的第(7 - i%8)位(高位在前);
+// 探测位为128位hash的前两个32位分量对位数取模
+// 只从映射中读出，直接指向映射中的bloom; 映射须比filter活得久
+class LegacyBF {
+   public:
+    const uint8_t* bytes = nullptr;
+    LegacyBF() = default;
+    explicit LegacyBF(const char* p)
+        : bytes(reinterpret_cast<const uint8_t*>(p)) {}
+    bool test(uint32_t pos) const { return bytes[pos / 8] >> (7 - pos % 8) & 1; }
+    bool query(const uint64_t& key) const {
+        uint32_t hashRes[4];
+        MurmurHash3_x64_128(&key, sizeof(key), 1, hashRes);
+        return test(hashRes[0] % LEGACY_BF_BITNUM) &&
+               test(hashRes[1] % LEGACY_BF_BITNUM);
+    }
+    size_t byteNum() const { return bytes ? SS_LEGACY_BLOOM_BYTENUM : 0; }
+};
+
+// BlockedBF - 分块bloom filter (split block bloom filter)
+// 每个key只落在一个BLOCKED_BF_BLOCK_BITNUM位的block内，构建时block按32字节对齐，
+// 不会跨cache line(从sst映射读出的不保证对齐，至多跨两条);
+// block内8个32位word各置1位，一次AVX2比较即可完成查询
+class BlockedBF {
+   private:
+    // 8个奇数乘子，把key的32位hash分散到8个word内的bit位置
+    static constexpr uint32_t SALT[BLOCKED_BF_HASHFUN_NUM] = {
+        0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+        0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U};
+    static constexpr size_t WORDS_PER_BLOCK = BLOCKED_BF_BLOCK_BITNUM / 32;
+
+    void allocate(uint32_t _blockNum) {
+        blockNum = _blockNum;
+        view = nullptr;
+        size_t bytes = byteNum();
+        // aligned_alloc要求大小为对齐粒度的整数倍
+        size_t allocBytes = (bytes + CACHE_LINE_BYTENUM - 1) /
+                            CACHE_LINE_BYTENUM * CACHE_LINE_BYTENUM;
+        words = allocBytes ? static_cast<uint32_t*>(
+                                 std::aligned_alloc(CACHE_LINE_BYTENUM, allocBytes))
+                           : nullptr;
+        if (words) std::memset(words, 0, bytes);
+    }
+    static void getHashValue(const uint64_t& key, uint64_t& h) {
+        uint64_t hashRes[2];
+        MurmurHash3_x64_128(&key, sizeof(key), 1, hashRes);
+        h = hashRes[0];
     }
-    ~BF() {
-        if (bitArray != nullptr) delete[] bitArray, bitArray = nullptr;
+    // block由hash高32位决定，block内的8个bit由低32位决定
+    size_t blockIndex(uint64_t h) const {
+        return (h >> 32) * uint64_t(blockNum) >> 32;
     }
-    BF& operator=(const BF& other) {
+    const char* blockOf(uint64_t h) const {
+        return bytes() + blockIndex(h) * (BLOCKED_BF_BLOCK_BITNUM / 8);
+    }
+
+   public:
+    uint32_t blockNum = 0;
+    uint32_t* words = nullptr;  // blockNum * WORDS_PER_BLOCK 个word，构建时使用
+    // 从sst读出时直接指向映射中的words，不拷贝; 映射须比filter活得久
+    const char* view = nullptr;
+
+    BlockedBF() = default;
+    BlockedBF(size_t keyNum, double bitsPerKey) {
+        size_t bits = size_t(std::ceil(keyNum * bitsPerKey));
+        allocate(std::max<size_t>(1, (bits + BLOCKED_BF_BLOCK_BITNUM - 1) /
+                                         BLOCKED_BF_BLOCK_BITNUM));
+    }
+    BlockedBF(const BlockedBF& other) { copyFrom(other); }
+    BlockedBF& operator=(const BlockedBF& other) {
         if (this != &other) {
-            if (bitArray != nullptr) delete[] bitArray, bitArray = nullptr;
-            m = other.m;
-            k = other.k;
-            bitArray = new bool[m];
-            for (int i = 0; i < m; i++) {
-                bitArray[i] = other.bitArray[i];
-            }
+            std::free(words);
+            copyFrom(other);
         }
         return *this;
     }
-    void getHashValue(const uint64_t& key, uint32_t* hashRes) {
-        MurmurHash3_x64_128(&key, sizeof(key), 1, hashRes);
+    BlockedBF(BlockedBF&& other) noexcept
+        : blockNum(other.blockNum), words(other.words), view(other.view) {
+        other.blockNum = 0;
+        other.words = nullptr;
+        other.view = nullptr;
     }
-    void insert(const uint64_t& key) {
-        for (int i = 0; i < k; i++) {
-            uint32_t hashRes[4];
-            getHashValue(key, hashRes);
-            bitArray[hashRes[0] % m] = true;
-            bitArray[hashRes[1] % m] = true;
+    BlockedBF& operator=(BlockedBF&& other) noexcept {
+        if (this != &other) {
+            std::free(words);
+            blockNum = other.blockNum, words = other.words, view = other.view;
+            other.blockNum = 0, other.words = nullptr, other.view = nullptr;
         }
+        return *this;
     }
-    bool query(const uint64_t& key) {
-        for (int i = 0; i < k; i++) {
-            uint32_t hashRes[4];
-            getHashValue(key, hashRes);
-            if (!bitArray[hashRes[0] % m] || !bitArray[hashRes[1] % m]) {
-                return false;
-            }
+    ~BlockedBF() { std::free(words); }
+    // copyFrom - view只复制指针，自有的words则深拷贝
+    void copyFrom(const BlockedBF& other) {
+        if (other.view) {
+            blockNum = other.blockNum, words = nullptr, view = other.view;
+            return;
         }
-        return true;
+        allocate(other.blockNum);
+        if (words) std::memcpy(words, other.words, byteNum());
+    }
+    const char* bytes() const {
+        return view ? view : reinterpret_cast<const char*>(words);
+    }
+
+    void insert(const uint64_t& key) {
+        uint64_t h;
+        getHashValue(key, h);
+        uint32_t* block = words + blockIndex(h) * WORDS_PER_BLOCK;
+        for (size_t i = 0; i < WORDS_PER_BLOCK; i++)
+            block[i] |= uint32_t(1) << ((uint32_t(h) * SALT[i]) >> 27);
+    }
+    bool queryScalar(const uint64_t& key) const {
+        uint64_t h;
+        getHashValue(key, h);
+        const char* block = blockOf(h);
+        uint32_t hit = 1;
+        for (size_t i = 0; i < WORDS_PER_BLOCK; i++) {
+            uint32_t word;
+            std::memcpy(&word, block + sizeof(word) * i, sizeof(word));
+            hit &= word >> ((uint32_t(h) * SALT[i]) >> 27);
+        }
+        return hit & 1;
+    }
+#if defined(__x86_64__)
+    // queryAVX2 - 8个word的bit位置在一个256位寄存器内并行计算与比较
+    // 映射中的words不一定按32字节对齐，用非对齐load，对齐时同样快
+    __attribute__((target("avx2"))) bool queryAVX2(const uint64_t& key) const {
+        uint64_t h;
+        getHashValue(key, h);
+        const __m256i salt =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(SALT));
+        __m256i shift = _mm256_srli_epi32(
+            _mm256_mullo_epi32(_mm256_set1_epi32(uint32_t(h)), salt), 27);
+        __m256i mask = _mm256_sllv_epi32(_mm256_set1_epi32(1), shift);
+        __m256i block =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(blockOf(h)));
+        // mask中的每一位都在block中置位
+        return _mm256_testc_si256(block, mask);
+    }
+#endif
+    bool query(const uint64_t& key) const {
+        if (!blockNum) return true;
+#if defined(__x86_64__)
+        static const bool hasAVX2 = __builtin_cpu_supports("avx2");
+        if (hasAVX2) return queryAVX2(key);
+#endif
+        return queryScalar(key);
+    }
+    size_t byteNum() const { return size_t(blockNum) * BLOCKED_BF_BLOCK_BITNUM / 8; }
+    // sst中的格式: [blockNum(u32)|words]
+    void writeTo(std::ostream& out) const {
+        out.write(reinterpret_cast<const char*>(&blockNum), sizeof(blockNum));
+        out.write(bytes(), byteNum());
+    }
+    // viewFrom - 在p处最多availBytes字节内解析，words不拷贝;
+    // 返回占用的字节数，格式不合法时返回0
+    size_t viewFrom(const char* p, size_t availBytes) {
+        uint32_t _blockNum;
+        if (availBytes < sizeof(_blockNum)) return 0;
+        std::memcpy(&_blockNum, p, sizeof(_blockNum));
+        size_t bytesNum = sizeof(_blockNum) +
+                          size_t(_blockNum) * BLOCKED_BF_BLOCK_BITNUM / 8;
+        if (bytesNum > availBytes) return 0;
+        std::free(words);
+        words = nullptr;
+        blockNum = _blockNum;
+        view = p + sizeof(_blockNum);
+        return bytesNum;
     }
-};
\ No newline at end of file
+};
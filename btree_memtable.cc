@@ -0,0 +1,176 @@
+#include "btree_memtable.h"
+
+#include <algorithm>
+#include <mutex>
+#include <new>
+
+namespace skiplist {
+btree_memtable_type::btree_memtable_type(size_t arenaBlockBytes)
+    : arena(arenaBlockBytes), length(0) {
+    root = newLeaf();
+}
+BTreeLeaf *btree_memtable_type::newLeaf() {
+    BTreeLeaf *leaf = new (arena.allocate(sizeof(BTreeLeaf))) BTreeLeaf;
+    leaf->isLeaf = true;
+    leaf->keyNum = 0;
+    leaf->nextLeaf = nullptr;
+    return leaf;
+}
+BTreeInner *btree_memtable_type::newInner() {
+    BTreeInner *inner = new (arena.allocate(sizeof(BTreeInner))) BTreeInner;
+    inner->isLeaf = false;
+    inner->keyNum = 0;
+    return inner;
+}
+const BTreeLeaf *btree_memtable_type::findLeaf(key_type key) const {
+    const BTreeNode *node = root;
+    while (!node->isLeaf) {
+        const BTreeInner *inner = static_cast<const BTreeInner *>(node);
+        int idx = std::upper_bound(inner->keys, inner->keys + inner->keyNum,
+                                   key) -
+                  inner->keys;
+        node = inner->children[idx];
+    }
+    return static_cast<const BTreeLeaf *>(node);
+}
+bool btree_memtable_type::insert(BTreeNode *node, key_type key,
+                                 const VlogPointer &val, key_type &splitKey,
+                                 BTreeNode *&sibling) {
+    if (node->isLeaf) {
+        BTreeLeaf *leaf = static_cast<BTreeLeaf *>(node);
+        int pos =
+            std::lower_bound(leaf->keys, leaf->keys + leaf->keyNum, key) -
+            leaf->keys;
+        if (pos < leaf->keyNum && leaf->keys[pos] == key) {
+            if (leaf->values[pos].offset < val.offset) leaf->values[pos] = val;
+            return false;
+        }
+        std::copy_backward(leaf->keys + pos, leaf->keys + leaf->keyNum,
+                           leaf->keys + leaf->keyNum + 1);
+        std::copy_backward(leaf->values + pos, leaf->values + leaf->keyNum,
+                           leaf->values + leaf->keyNum + 1);
+        leaf->keys[pos] = key;
+        leaf->values[pos] = val;
+        leaf->keyNum++;
+        length.fetch_add(1, std::memory_order_relaxed);
+        if (leaf->keyNum <= BTREE_NODE_KEYNUM) return false;
+
+        // 追加在末尾(递增key)时左侧保持满载，否则对半分
+        int leftNum = pos == BTREE_NODE_KEYNUM ? BTREE_NODE_KEYNUM
+                                               : (BTREE_NODE_KEYNUM + 1) / 2;
+        BTreeLeaf *right = newLeaf();
+        right->keyNum = leaf->keyNum - leftNum;
+        std::copy(leaf->keys + leftNum, leaf->keys + leaf->keyNum,
+                  right->keys);
+        std::copy(leaf->values + leftNum, leaf->values + leaf->keyNum,
+                  right->values);
+        leaf->keyNum = leftNum;
+        right->nextLeaf = leaf->nextLeaf;
+        leaf->nextLeaf = right;
+        splitKey = right->keys[0];
+        sibling = right;
+        return true;
+    }
+
+    BTreeInner *inner = static_cast<BTreeInner *>(node);
+    int idx =
+        std::upper_bound(inner->keys, inner->keys + inner->keyNum, key) -
+        inner->keys;
+    key_type childSplitKey;
+    BTreeNode *childSibling;
+    if (!insert(inner->children[idx], key, val, childSplitKey, childSibling))
+        return false;
+    std::copy_backward(inner->keys + idx, inner->keys + inner->keyNum,
+                       inner->keys + inner->keyNum + 1);
+    std::copy_backward(inner->children + idx + 1,
+                       inner->children + inner->keyNum + 1,
+                       inner->children + inner->keyNum + 2);
+    inner->keys[idx] = childSplitKey;
+    inner->children[idx + 1] = childSibling;
+    inner->keyNum++;
+    if (inner->keyNum <= BTREE_NODE_KEYNUM) return false;
+
+    // keys[mid]上移到父节点，右侧取其后的key与child
+    int mid = idx == BTREE_NODE_KEYNUM ? BTREE_NODE_KEYNUM
+                                       : BTREE_NODE_KEYNUM / 2;
+    BTreeInner *right = newInner();
+    right->keyNum = inner->keyNum - mid - 1;
+    std::copy(inner->keys + mid + 1, inner->keys + inner->keyNum,
+              right->keys);
+    std::copy(inner->children + mid + 1, inner->children + inner->keyNum + 1,
+              right->children);
+    inner->keyNum = mid;
+    splitKey = inner->keys[mid];
+    sibling = right;
+    return true;
+}
+void btree_memtable_type::put(key_type key, const VlogPointer &val) {
+    std::unique_lock<std::shared_mutex> lock(treeMutex);
+    key_type splitKey;
+    BTreeNode *sibling;
+    if (!insert(root, key, val, splitKey, sibling)) return;
+    // 根分裂，树长高一层
+    BTreeInner *newRoot = newInner();
+    newRoot->keyNum = 1;
+    newRoot->keys[0] = splitKey;
+    newRoot->children[0] = root;
+    newRoot->children[1] = sibling;
+    root = newRoot;
+}
+std::optional<VlogPointer> btree_memtable_type::get(key_type key) const {
+    std::shared_lock<std::shared_mutex> lock(treeMutex);
+    const BTreeLeaf *leaf = findLeaf(key);
+    int pos = std::lower_bound(leaf->keys, leaf->keys + leaf->keyNum, key) -
+              leaf->keys;
+    if (pos < leaf->keyNum && leaf->keys[pos] == key)
+        return leaf->values[pos];
+    return std::nullopt;
+}
+void btree_memtable_type::scan(
+    uint64_t key1, uint64_t key2,
+    std::list<std::pair<uint64_t, VlogPointer>> &list) {
+    std::shared_lock<std::shared_mutex> lock(treeMutex);
+    const BTreeLeaf *leaf = findLeaf(key1);
+    int pos = std::lower_bound(leaf->keys, leaf->keys + leaf->keyNum, key1) -
+              leaf->keys;
+    while (leaf) {
+        for (; pos < leaf->keyNum; pos++) {
+            if (leaf->keys[pos] > key2) return;
+            list.emplace_back(leaf->keys[pos], leaf->values[pos]);
+        }
+        leaf = leaf->nextLeaf;
+        pos = 0;
+    }
+}
+// BTreeIterator - 沿nextLeaf链表遍历所有叶子
+class BTreeIterator : public memtable_type::Iterator {
+   private:
+    const BTreeLeaf *leaf;
+    int pos = 0;
+
+    void skipEmptyLeaves() {
+        while (leaf && pos >= leaf->keyNum) {
+            leaf = leaf->nextLeaf;
+            pos = 0;
+        }
+    }
+
+   public:
+    explicit BTreeIterator(const BTreeLeaf *first) : leaf(first) {
+        skipEmptyLeaves();
+    }
+    bool valid() const override { return leaf != nullptr; }
+    void next() override {
+        pos++;
+        skipEmptyLeaves();
+    }
+    key_type key() const override { return leaf->keys[pos]; }
+    VlogPointer value() const override { return leaf->values[pos]; }
+};
+std::unique_ptr<memtable_type::Iterator> btree_memtable_type::newIterator()
+    const {
+    // 最左叶子即key最小的叶子
+    return std::make_unique<BTreeIterator>(findLeaf(0));
+}
+
+}  // namespace skiplist
@@ -0,0 +1,69 @@
+#ifndef BTREE_MEMTABLE_H
+#define BTREE_MEMTABLE_H
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <optional>
+#include <shared_mutex>
+
+#include "arena.h"
+#include "memtable.h"
+
+// 每个节点最多容纳的key数，32个uint64_t恰好占4条cache line
+#define BTREE_NODE_KEYNUM 32
+
+namespace skiplist {
+
+// BTreeNode - 节点公共部分，keys多留一格用于插入后再分裂
+struct BTreeNode {
+    bool isLeaf;
+    int keyNum;
+    key_type keys[BTREE_NODE_KEYNUM + 1];
+};
+// BTreeInner - children[i]中的key位于[keys[i-1], keys[i])
+struct BTreeInner : BTreeNode {
+    BTreeNode *children[BTREE_NODE_KEYNUM + 2];
+};
+// BTreeLeaf - 叶子之间以nextLeaf串成有序链表，供scan顺序遍历
+struct BTreeLeaf : BTreeNode {
+    VlogPointer values[BTREE_NODE_KEYNUM + 1];
+    BTreeLeaf *nextLeaf;
+};
+
+// btree_memtable_type - 以uint64_t为key的B+树memTable
+// 节点宽而浅，查找时每层只访问一段连续的key数组，对cache友好
+// 并发: 写者之间由读写锁串行化，读者共享锁下并发
+class btree_memtable_type : public memtable_type {
+   private:
+    Arena arena;
+    BTreeNode *root;
+    std::atomic<int> length;
+    mutable std::shared_mutex treeMutex;
+
+    BTreeLeaf *newLeaf();
+    BTreeInner *newInner();
+    const BTreeLeaf *findLeaf(key_type key) const;
+    // insert - 返回true表示node已分裂，splitKey/sibling带回新的右兄弟
+    bool insert(BTreeNode *node, key_type key, const VlogPointer &val,
+                key_type &splitKey, BTreeNode *&sibling);
+
+   public:
+    explicit btree_memtable_type(
+        size_t arenaBlockBytes = ARENA_DEFAULT_BLOCK_BYTENUM);
+    // 节点全部位于arena中，析构时随arena整体释放
+    ~btree_memtable_type() override = default;
+    int getLength() override {
+        return length.load(std::memory_order_relaxed);
+    }
+    void put(key_type key, const VlogPointer &val) override;
+    std::optional<VlogPointer> get(key_type key) const override;
+    void scan(uint64_t key1, uint64_t key2,
+              std::list<std::pair<uint64_t, VlogPointer>> &list) override;
+    std::unique_ptr<Iterator> newIterator() const override;
+    size_t memoryUsage() const override { return arena.memoryUsage(); }
+};
+
+}  // namespace skiplist
+
+#endif  // BTREE_MEMTABLE_H
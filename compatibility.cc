@@ -0,0 +1,184 @@
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <list>
+#include <stdexcept>
+#include <string>
+
+#include "test.h"
+
+// test/baseline_data由sst仍是[header|512B bloom|定长entry]格式时的版本写入:
+// 先put [0, BASELINE_MAX)，再覆盖5的倍数，最后删除7的倍数
+class CompatibilityTest : public Test
+{
+private:
+	const uint64_t BASELINE_MAX = 2000;
+	const uint64_t TEST_MAX = 3000;
+
+	static std::string baselineValue(uint64_t i, int round)
+	{
+		return "baseline-" + std::to_string(round) + "-" +
+			   std::string(i % 23 + 1, char('a' + i % 26));
+	}
+	std::string baselineExpected(uint64_t i)
+	{
+		if (i >= BASELINE_MAX || i % 7 == 0)
+			return not_found;
+		return baselineValue(i, i % 5 == 0);
+	}
+	// 在旧数据之上: put [BASELINE_MAX / 2, TEST_MAX)，再删除11的倍数
+	std::string finalExpected(uint64_t i)
+	{
+		if (i % 11 == 0)
+			return not_found;
+		if (i >= BASELINE_MAX / 2)
+			return baselineValue(i, 2);
+		return baselineExpected(i);
+	}
+	void checkAll(bool final)
+	{
+		for (uint64_t i = 0; i < TEST_MAX; ++i)
+			EXPECTI(final ? finalExpected(i) : baselineExpected(i), store.get(i), i);
+		std::list<std::pair<uint64_t, std::string>> expected, got;
+		for (uint64_t i = 0; i < TEST_MAX; ++i)
+		{
+			std::string value = final ? finalExpected(i) : baselineExpected(i);
+			if (value != not_found)
+				expected.emplace_back(i, value);
+		}
+		store.scan(0, TEST_MAX - 1, got);
+		EXPECT(expected.size(), got.size());
+		EXPECT(true, expected == got);
+	}
+
+public:
+	// prepare - 打开旧数据，读出全部key后在其上继续写入与gc
+	void prepare()
+	{
+		std::cout << "KVStore Compatibility Test" << std::endl;
+		std::cout << "<<Preparation Mode>>" << std::endl;
+
+		checkAll(false);
+		phase();
+
+		for (uint64_t i = BASELINE_MAX / 2; i < TEST_MAX; ++i)
+			store.put(i, baselineValue(i, 2));
+		for (uint64_t i = 0; i < TEST_MAX; i += 11)
+			store.del(i);
+		checkAll(true);
+		phase();
+
+		// 旧数据的vlog entry也要能被gc搬运
+		check_gc(64 * 1024);
+		checkAll(true);
+		phase();
+
+		report();
+	}
+	// test - 重新打开后旧格式与新格式的sst共存
+	void test()
+	{
+		std::cout << "<<Test Mode>>" << std::endl;
+
+		checkAll(true);
+		phase();
+
+		report();
+	}
+
+	CompatibilityTest(const std::string &dir, const std::string &vlog, bool v = true,
+					  const KVStoreOptions &options = KVStoreOptions()) : Test(dir, vlog, v, options)
+	{
+	}
+};
+
+// copyBaseline - 测试会改写数据目录，先把test/baseline_data复制一份
+static void copyBaseline(const std::string &from, const std::string &to)
+{
+	std::filesystem::remove_all(to);
+	std::filesystem::copy(from, to, std::filesystem::copy_options::recursive);
+}
+
+// downgradeFooters - 把dir下version 2的sst改写成version 1: footer去掉开头的vlogEnd
+// 返回改写的sst数
+static int downgradeFooters(const std::string &dir)
+{
+	int converted = 0;
+	for (auto &entry : std::filesystem::recursive_directory_iterator(dir))
+	{
+		if (entry.path().extension() != ".sst")
+			continue;
+		std::ifstream in(entry.path(), std::ios::binary);
+		std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+		in.close();
+		if (bytes.size() < SS_HEADER_BYTENUM + SS_FOOTER_BYTENUM)
+			continue;
+		uint32_t version, magic;
+		std::memcpy(&version, bytes.data() + bytes.size() - 8, sizeof(version));
+		std::memcpy(&magic, bytes.data() + bytes.size() - 4, sizeof(magic));
+		if (magic != SS_FOOTER_MAGIC || version != SS_FORMAT_VERSION)
+			continue;
+		version = 1;
+		std::memcpy(&bytes[bytes.size() - 8], &version, sizeof(version));
+		bytes.erase(bytes.size() - SS_FOOTER_BYTENUM, SS_FOOTER_BYTENUM - SS_FOOTER_V1_BYTENUM);
+		std::ofstream out(entry.path(), std::ios::binary | std::ios::trunc);
+		out.write(bytes.data(), bytes.size());
+		converted++;
+	}
+	return converted;
+}
+
+int main(int argc, char *argv[])
+{
+	bool verbose = (argc == 2 && std::string(argv[1]) == "-v");
+
+	std::cout << "Usage: " << argv[0] << " [-v]" << std::endl;
+	std::cout << "  -v: print extra info for failed tests [currently ";
+	std::cout << (verbose ? "ON" : "OFF") << "]" << std::endl;
+	std::cout << std::endl;
+	std::cout.flush();
+
+	copyBaseline("./test/baseline_data", "./data_compat");
+	{
+		// entry数组几乎都不在tableCache中，旧格式sst的get直接在映射上查找
+		KVStoreOptions options;
+		options.tableCacheBytes = 1;
+		CompatibilityTest test("./data_compat", "./data_compat/vlog", verbose, options);
+		test.prepare();
+	}
+	{
+		CompatibilityTest test("./data_compat", "./data_compat/vlog", verbose);
+		test.test();
+	}
+
+	// version 1的footer没有vlogEnd，打开时需解码entry计算vlog的重放起点
+	std::cout << "<<Version 1 Footer>>" << std::endl;
+	int converted = downgradeFooters("./data_compat");
+	std::cout << "  Downgraded " << converted << " sst: " << (converted ? "[PASS]" : "[FAIL]") << std::endl;
+	{
+		CompatibilityTest test("./data_compat", "./data_compat/vlog", verbose);
+		test.test();
+	}
+
+	// 截断的旧格式sst与两种格式都对不上，必须拒绝打开而不是按某种格式猜测
+	std::cout << "<<Unknown Format>>" << std::endl;
+	copyBaseline("./test/baseline_data", "./data_compat");
+	std::filesystem::resize_file("./data_compat/level-1/4.sst", 8192);
+	bool refused = false;
+	try
+	{
+		KVStore store("./data_compat", "./data_compat/vlog");
+	}
+	catch (const std::runtime_error &e)
+	{
+		refused = true;
+		if (verbose)
+			std::cerr << e.what() << std::endl;
+	}
+	std::cout << "  Refused to open: " << (refused ? "[PASS]" : "[FAIL]") << std::endl;
+	std::filesystem::remove_all("./data_compat");
+
+	return 0;
+}
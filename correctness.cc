@@ -2,6 +2,9 @@
 #include <cstdint>
 #include <string>
 #include <assert.h>
+#include <atomic>
+#include <thread>
+#include <vector>
 
 #include "test.h"
 
@@ -11,6 +14,7 @@ private:
 	const uint64_t SIMPLE_TEST_MAX = 512;
 	const uint64_t LARGE_TEST_MAX = 1024 * 64;
 	const uint64_t GC_TEST_MAX = 1024 * 48;
+	const uint64_t CONCURRENT_GC_TEST_MAX = 1024 * 8;
 
 	void regular_test(uint64_t max)
 	{
@@ -191,6 +195,61 @@ private:
 		report();
 	}
 
+	// concurrent_gc_test - 读线程持续get，写线程覆盖写入，主线程并发gc;
+	// gc在旧位置打洞时不能有读者正从该处读value
+	void concurrent_gc_test(uint64_t max)
+	{
+		const int rounds = 3;
+		const int readers = 2;
+		auto value = [](uint64_t i, int round)
+		{ return std::string(i % 256 + 1, char('a' + round)); };
+
+		for (uint64_t i = 0; i < max; ++i)
+			store.put(i, value(i, 0));
+
+		std::atomic<bool> stop(false);
+		std::atomic<uint64_t> bad(0);
+		std::vector<std::thread> threads;
+		for (int t = 0; t < readers; ++t)
+			threads.emplace_back([&, t]()
+								 {
+				for (uint64_t n = t; !stop; n += 7919) {
+					uint64_t i = n % max;
+					std::string got = store.get(i);
+					bool ok = false;
+					for (int round = 0; round < rounds; ++round)
+						ok |= got == value(i, round);
+					if (!ok)
+						bad++;
+				} });
+		// 写者与gc并发: gc重新写入的旧value不能覆盖其间写入的新value
+		std::atomic<bool> writing(true);
+		threads.emplace_back([&]()
+							 {
+			for (int round = 1; round < rounds; ++round)
+				for (uint64_t i = 0; i < max; ++i)
+					store.put(i, value(i, round));
+			writing = false; });
+		while (writing)
+		{
+			if (store.getHead() - store.getTail() > 512 * 1024)
+				store.gc(256 * 1024);
+			else
+				std::this_thread::yield();
+		}
+		stop = true;
+		for (auto &thread : threads)
+			thread.join();
+		EXPECT(uint64_t(0), bad.load());
+
+		for (uint64_t i = 0; i < max; ++i)
+			EXPECT(value(i, rounds - 1), store.get(i));
+
+		phase();
+
+		report();
+	}
+
 public:
 	CorrectnessTest(const std::string &dir, const std::string &vlog, bool v = true) : Test(dir, vlog, v)
 	{
@@ -214,6 +273,11 @@ public:
 
 		std::cout << "[GC Test]" << std::endl;
 		gc_test(GC_TEST_MAX);
+
+		store.reset();
+
+		std::cout << "[Concurrent GC Test]" << std::endl;
+		concurrent_gc_test(CONCURRENT_GC_TEST_MAX);
 	}
 };
 
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "type.h"
+
+// EytzingerIndex - 有序key数组的BFS(Eytzinger)排列，只存在于内存中
+// 节点k的孩子是2k与2k+1，查找路径上前几层集中在数组开头、常驻cache;
+// 每步无分支地下降，并预取EYTZINGER_PREFETCH_LEVEL层之后的节点
+// 节点在原有序数组中的下标(中序序号)由树形直接算出，据此取offsetList/vlenList，
+// 不另存下标数组，省去一次访存
+class EytzingerIndex {
+   private:
+    std::vector<KEY_TL> keys;  // keys[0]不用，keys[1..n]为BFS顺序
+    int height = 0;            // 树高，最后一层可能不满
+    size_t lastLevelNum = 0;   // 最后一层的节点数，都靠左
+
+    // fill - 中序遍历BFS树，依次填入有序数组的第i个key
+    void fill(const KEY_TL *sorted, size_t &i, size_t k) {
+        if (k >= keys.size()) return;
+        fill(sorted, i, 2 * k);
+        keys[k] = sorted[i++];
+        fill(sorted, i, 2 * k + 1);
+    }
+    // rankOf - 先按满二叉树算中序序号r: 最后一层的叶子占偶数序号，
+    // 其中只有前lastLevelNum个存在，再减去序号小于r的缺失叶子数
+    size_t rankOf(size_t k) const {
+        int depth = 63 - __builtin_clzll(k);
+        size_t r = ((2 * (k - (size_t(1) << depth)) + 1)
+                    << (height - 1 - depth)) -
+                   1;
+        size_t present = 2 * lastLevelNum;
+        return r < present ? r : r - (r - present + 1) / 2;
+    }
+
+   public:
+    // 空索引: find总是返回-1，调用者应退回二分查找
+    EytzingerIndex() = default;
+    EytzingerIndex(const KEY_TL *sorted, size_t keyNum) : keys(keyNum + 1) {
+        if (!keyNum) return;
+        height = 64 - __builtin_clzll(keyNum);
+        lastLevelNum = keyNum - ((size_t(1) << (height - 1)) - 1);
+        size_t i = 0;
+        fill(sorted, i, 1);
+    }
+    bool empty() const { return keys.size() <= 1; }
+    // find - 返回key在原有序数组中的下标，不存在时返回-1
+    int find(KEY_TL key) const {
+        if (empty()) return -1;
+        const KEY_TL *base = keys.data();
+        size_t n = keys.size() - 1, k = 1;
+        while (k <= n) {
+            // k的第EYTZINGER_PREFETCH_LEVEL层后代连续存放，共64字节
+            __builtin_prefetch(base + (k << EYTZINGER_PREFETCH_LEVEL));
+            k = 2 * k + (base[k] < key);
+        }
+        // 去掉末尾的1与其后的0，得到第一个>= key的节点(lower_bound)
+        k >>= __builtin_ffsll(~k);
+        return k && base[k] == key ? int(rankOf(k)) : -1;
+    }
+    size_t byteNum() const { return keys.size() * sizeof(KEY_TL); }
+};
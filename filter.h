@@ -0,0 +1,164 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <variant>
+#include <vector>
+
+#include "bloomfilter.h"
+#include "type.h"
+#include "xorfilter.h"
+
+// FilterType - sst filter的种类，作为type tag写入sst的filter区
+enum class FilterType : uint8_t {
+    NONE = 0,           // 不建filter，query总是返回true
+    BLOOM = 1,          // BF
+    BLOCKED_BLOOM = 2,  // BlockedBF，每次查询只访问一条cache line
+    XOR = 3,            // XorFilter，固定约9.84 bit/key，误判率约0.4%
+    LEGACY_BLOOM = 4,   // LegacyBF，只从旧格式sst读出，不写入
+};
+
+// SSTFilter - 一个sst的filter，sst不可变，构建时即拿到全部key
+class SSTFilter {
+   private:
+    std::variant<std::monostate, BF, BlockedBF, XorFilter, LegacyBF> impl;
+
+   public:
+    SSTFilter() = default;
+    // build - 为keys[0..keyNum)构建指定类型的filter
+    // bitsPerKey <= 0 时不建filter; XOR的大小只由keyNum决定
+    static SSTFilter build(FilterType type, const KEY_TL *keys, size_t keyNum,
+                           double bitsPerKey) {
+        SSTFilter filter;
+        if (bitsPerKey <= 0) return filter;
+        switch (type) {
+            case FilterType::BLOOM:
+                filter.impl.emplace<BF>(keyNum, bitsPerKey);
+                for (size_t i = 0; i < keyNum; i++)
+                    std::get<BF>(filter.impl).insert(keys[i]);
+                break;
+            case FilterType::BLOCKED_BLOOM:
+                filter.impl.emplace<BlockedBF>(keyNum, bitsPerKey);
+                for (size_t i = 0; i < keyNum; i++)
+                    std::get<BlockedBF>(filter.impl).insert(keys[i]);
+                break;
+            case FilterType::XOR:
+                filter.impl.emplace<XorFilter>(keys, keyNum);
+                break;
+            default:
+                break;
+        }
+        return filter;
+    }
+    // legacy - 旧格式sst中header之后的bloom
+    static SSTFilter legacy(const char *p) {
+        SSTFilter filter;
+        filter.impl.emplace<LegacyBF>(p);
+        return filter;
+    }
+    FilterType type() const { return FilterType(impl.index()); }
+    bool query(const KEY_TL &key) const {
+        switch (impl.index()) {
+            case 1:
+                return std::get<BF>(impl).query(key);
+            case 2:
+                return std::get<BlockedBF>(impl).query(key);
+            case 3:
+                return std::get<XorFilter>(impl).query(key);
+            case 4:
+                return std::get<LegacyBF>(impl).query(key);
+            default:
+                return true;
+        }
+    }
+    // byteNum - filter主体占用的内存字节数
+    size_t byteNum() const {
+        switch (impl.index()) {
+            case 1:
+                return std::get<BF>(impl).byteNum();
+            case 2:
+                return std::get<BlockedBF>(impl).byteNum();
+            case 3:
+                return std::get<XorFilter>(impl).byteNum();
+            case 4:
+                return std::get<LegacyBF>(impl).byteNum();
+            default:
+                return 0;
+        }
+    }
+    // writeTo - LegacyBF不写入新格式，写作NONE
+    void writeTo(std::ostream &out) const {
+        uint8_t tag = impl.index() == 4 ? uint8_t(FilterType::NONE)
+                                        : uint8_t(type());
+        out.write(reinterpret_cast<const char *>(&tag), sizeof(tag));
+        if (impl.index() == 1) std::get<BF>(impl).writeTo(out);
+        if (impl.index() == 2) std::get<BlockedBF>(impl).writeTo(out);
+        if (impl.index() == 3) std::get<XorFilter>(impl).writeTo(out);
+    }
+    // viewFrom - 解析type tag及对应内容，filter的bit直接指向p所在的映射，
+    // 映射须比filter活得久; 返回占用的字节数，不认识的tag或内容不合法时返回0
+    size_t viewFrom(const char *p, size_t availBytes) {
+        if (availBytes < SS_FILTER_TYPE_BYTENUM) return 0;
+        FilterType tag = FilterType(uint8_t(*p));
+        p += SS_FILTER_TYPE_BYTENUM;
+        availBytes -= SS_FILTER_TYPE_BYTENUM;
+        size_t bytesNum = 0;
+        switch (tag) {
+            case FilterType::NONE:
+                impl.emplace<std::monostate>();
+                return SS_FILTER_TYPE_BYTENUM;
+            case FilterType::BLOOM:
+                bytesNum = impl.emplace<BF>().viewFrom(p, availBytes);
+                break;
+            case FilterType::BLOCKED_BLOOM:
+                bytesNum = impl.emplace<BlockedBF>().viewFrom(p, availBytes);
+                break;
+            case FilterType::XOR:
+                bytesNum = impl.emplace<XorFilter>().viewFrom(p, availBytes);
+                break;
+            default:
+                break;
+        }
+        if (!bytesNum) {
+            impl.emplace<std::monostate>();
+            return 0;
+        }
+        return SS_FILTER_TYPE_BYTENUM + bytesNum;
+    }
+};
+
+// monkeyBitsPerKey - Monkey式分配: 总内存不变(平均avgBitsPerKey)，
+// 最小化零结果查询在各run上的误判次数之和 sum(p_i)
+// 拉格朗日乘子法得 p_i 与run的entry数n_i成正比，即越深(越大)的run分到的
+// bits/key越少; p_i达到1的run不建filter，其预算让给其余run
+inline std::vector<double> monkeyBitsPerKey(
+    const std::vector<double> &runEntries, double avgBitsPerKey) {
+    const double ln2sq = std::log(2.0) * std::log(2.0);
+    std::vector<double> bits(runEntries.size(), 0);
+    std::vector<bool> active(runEntries.size(), true);
+    double budget = 0;  // sum(n_i * ln(1 / p_i))
+    for (double n : runEntries) budget += n * avgBitsPerKey * ln2sq;
+    while (true) {
+        double sumN = 0, sumNLnN = 0;
+        for (size_t i = 0; i < runEntries.size(); i++) {
+            if (!active[i]) continue;
+            sumN += runEntries[i];
+            sumNLnN += runEntries[i] * std::log(runEntries[i]);
+        }
+        if (sumN == 0) break;
+        // p_i = lambda * n_i
+        double lnInvLambda = (budget + sumNLnN) / sumN;
+        bool capped = false;
+        for (size_t i = 0; i < runEntries.size(); i++) {
+            if (active[i] && lnInvLambda <= std::log(runEntries[i]))
+                active[i] = false, capped = true;
+        }
+        if (capped) continue;
+        for (size_t i = 0; i < runEntries.size(); i++)
+            if (active[i])
+                bits[i] = (lnInvLambda - std::log(runEntries[i])) / ln2sq;
+        break;
+    }
+    return bits;
+}
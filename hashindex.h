@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MurmurHash3.h"
+#include "sstblock.h"
+#include "type.h"
+
+// HashIndex - sst内key到entry下标的线性探测哈希表，随sst持久化
+// 槽位数约为kvNum / HASH_INDEX_LOAD_FACTOR，每槽存key哈希的高32位作指纹与下标+1;
+// 查询从哈希低32位等比映射到的槽向后探测，指纹相同才比较keyList中的key，
+// 遇到空槽即可断定不存在，不依赖key有序
+// sst中的hash index之后还存各data block首个entry的下标，不经cache的点查
+// 可直接在映射上探测，由下标定位到block与restart点(见probe)
+class HashIndex {
+   public:
+    struct Slot {
+        uint32_t fingerprint;
+        uint32_t pos;  // 下标+1，0表示空槽
+    };
+    std::vector<Slot> slots;
+
+   private:
+    // home - 乘后右移代替取模，槽位数不必是2的幂
+    size_t home(uint64_t h) const {
+        return size_t((uint64_t(uint32_t(h)) * slots.size()) >> 32);
+    }
+    size_t next(size_t s) const { return s + 1 == slots.size() ? 0 : s + 1; }
+
+   public:
+    // 空索引: find总是返回-1，调用者应退回二分查找
+    HashIndex() = default;
+    HashIndex(const KEY_TL *keys, size_t keyNum) {
+        if (!keyNum) return;
+        // 至少留一个空槽，find才能终止
+        size_t slotNum = size_t(keyNum / HASH_INDEX_LOAD_FACTOR) + 1;
+        slots.assign(slotNum, {0, 0});
+        for (size_t i = 0; i < keyNum; i++) {
+            uint64_t h = fmix64(keys[i]);
+            size_t s = home(h);
+            while (slots[s].pos) s = next(s);
+            slots[s] = {uint32_t(h >> 32), uint32_t(i + 1)};
+        }
+    }
+    bool empty() const { return slots.empty(); }
+    // find - keys须是建索引时的keyList，返回key的下标，不存在时返回-1
+    int find(KEY_TL key, const KEY_TL *keys) const {
+        if (slots.empty()) return -1;
+        uint64_t h = fmix64(key);
+        uint32_t fingerprint = uint32_t(h >> 32);
+        for (size_t s = home(h);; s = next(s)) {
+            const Slot &slot = slots[s];
+            if (!slot.pos) return -1;
+            if (slot.fingerprint == fingerprint && keys[slot.pos - 1] == key)
+                return int(slot.pos - 1);
+        }
+    }
+    size_t byteNum() const { return slots.size() * sizeof(Slot); }
+    // sst中的格式: [HASH_INDEX_MAGIC(u32)|slotNum(u32)] + 每槽 [fingerprint(u32)|pos(u32)]
+    //   + [blockNum(u32)] + 每个data block [首个entry的下标(u32)]
+    // magic用于与其前可选的learned index区分; 较早写入的sst没有block下标部分
+    void appendTo(std::string &buf,
+                  const std::vector<uint32_t> &blockStarts) const {
+        sstblock::putFixed32(buf, HASH_INDEX_MAGIC);
+        sstblock::putFixed32(buf, uint32_t(slots.size()));
+        for (auto &slot : slots) {
+            sstblock::putFixed32(buf, slot.fingerprint);
+            sstblock::putFixed32(buf, slot.pos);
+        }
+        sstblock::putFixed32(buf, uint32_t(blockStarts.size()));
+        for (uint32_t start : blockStarts) sstblock::putFixed32(buf, start);
+    }
+    // slotBytes - [p, p + bytes)中magic与槽数组的长度，格式不对时返回0
+    static size_t slotBytes(const char *p, size_t bytes) {
+        if (bytes < 2 * sizeof(uint32_t) ||
+            sstblock::getFixed32(p) != HASH_INDEX_MAGIC)
+            return 0;
+        uint32_t slotNum = sstblock::getFixed32(p + sizeof(uint32_t));
+        size_t n = 2 * sizeof(uint32_t) + size_t(slotNum) * sizeof(Slot);
+        return slotNum && n <= bytes ? n : 0;
+    }
+    // blockStartsValid - 槽数组之后的block下标部分长度吻合、首项为0且严格递增
+    static bool blockStartsValid(const char *p, size_t bytes, size_t keyNum) {
+        if (bytes < sizeof(uint32_t)) return false;
+        uint32_t blockNum = sstblock::getFixed32(p);
+        if (bytes != sizeof(uint32_t) * (size_t(blockNum) + 1)) return false;
+        for (uint32_t b = 0; b < blockNum; b++) {
+            uint32_t start = sstblock::getFixed32(p + sizeof(uint32_t) * (b + 1));
+            if (b ? start <= sstblock::getFixed32(p + sizeof(uint32_t) * b)
+                  : start != 0)
+                return false;
+            if (start >= keyNum) return false;
+        }
+        return true;
+    }
+    // probe - 不解码，直接在映射中的hash index上探测key;
+    // 指纹相同时调用match(下标)比较实际的key，返回true即找到
+    template <typename FnT>
+    static bool probe(const char *p, size_t bytes, KEY_TL key, FnT match) {
+        size_t n = slotBytes(p, bytes);
+        if (!n) return false;
+        size_t slotNum = (n - 2 * sizeof(uint32_t)) / sizeof(Slot);
+        const char *slotData = p + 2 * sizeof(uint32_t);
+        uint64_t h = fmix64(key);
+        uint32_t fingerprint = uint32_t(h >> 32);
+        size_t s = size_t((uint64_t(uint32_t(h)) * slotNum) >> 32);
+        for (size_t i = 0; i < slotNum; i++) {
+            const char *slot = slotData + sizeof(Slot) * s;
+            uint32_t pos = sstblock::getFixed32(slot + sizeof(uint32_t));
+            if (!pos) return false;
+            if (sstblock::getFixed32(slot) == fingerprint && match(pos - 1))
+                return true;
+            s = s + 1 == slotNum ? 0 : s + 1;
+        }
+        return false;
+    }
+    // decodeFrom - 长度须恰好吻合且下标不越界，否则返回false
+    bool decodeFrom(const char *p, size_t bytes, size_t keyNum) {
+        size_t n = slotBytes(p, bytes);
+        if (!n) return false;
+        if (n != bytes && !blockStartsValid(p + n, bytes - n, keyNum))
+            return false;
+        uint32_t slotNum = sstblock::getFixed32(p + sizeof(uint32_t));
+        p += 2 * sizeof(uint32_t);
+        slots.resize(slotNum);
+        size_t used = 0;
+        for (auto &slot : slots) {
+            slot.fingerprint = sstblock::getFixed32(p);
+            slot.pos = sstblock::getFixed32(p + sizeof(uint32_t));
+            p += sizeof(Slot);
+            if (slot.pos > keyNum) return false;
+            used += slot.pos != 0;
+        }
+        return used < slotNum;
+    }
+};
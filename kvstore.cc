@@ -1,5 +1,7 @@
 #include "kvstore.h"
 
+#include <cstdio>
+#include <stdexcept>
 #include <string>
 using namespace skiplist;
 // #define DET
@@ -8,23 +10,56 @@ using namespace skiplist;
 // #define WATCH
 // #define GC_DEBUG
 
-long visitInd = 0;
 
-std::vector<KVStore::PtrTrackProps> KVStore::ptrTracks;
-KVStore::KVStore(const std::string &dir, const std::string &vlog)
-    :  KVStoreAPI(dir, vlog),dir(dir), vlog(vlog) {
-    memTable = new skiplist_type();
+KVStore::KVStore(const std::string &dir, const std::string &vlog,
+                 const KVStoreOptions &options)
+    :  KVStoreAPI(dir, vlog),dir(dir), vlog(vlog), options(options),
+      memTableArenaBytes(std::clamp<size_t>(options.memTableBytes / 16,
+                                            ARENA_MIN_BLOCK_BYTENUM,
+                                            ARENA_DEFAULT_BLOCK_BYTENUM)),
+      sstEntryNum(
+          std::max<size_t>(1, options.sstTargetBytes / SS_ENTRY_BYTENUM)),
+      tableCache(options.tableCacheBytes) {
+    memTable = newMemTable();
+    immMemTable = nullptr;
     head = 0;
     tail = 0;
     largestUid = 0;
     largestTimeStamp = 0;
-    // 根据之前遗留数据，调整head / tail / largestUid / largestTimeStamp
-    examineOld();
+    // 根据之前遗留数据，调整head / tail / largestUid / largestTimeStamp，
+    // 并重放最后一次flush之后写入vlog的entry
+    // sst格式无法识别时抛出异常; 此时线程尚未启动，析构函数不会执行
+    try {
+        examineOld();
+    } catch (...) {
+        delete memTable;
+        throw;
+    }
+    openVlog();
+    syncedHead = head;
+    flushThread = std::thread(&KVStore::flushLoop, this);
+    if (options.syncMode == WalSyncMode::INTERVAL)
+        syncThread = std::thread(&KVStore::syncLoop, this);
 }
 KVStore::~KVStore() {
-    if (memTable->getLength()) convertAndWriteMemTable();
+    {
+        std::unique_lock<std::shared_mutex> lock(memMutex);
+        stopFlush = true;
+    }
+    flushCv.notify_all();
+    // flushLoop退出前会写完尚未flush的immMemTable
+    flushThread.join();
+    {
+        std::lock_guard<std::mutex> lock(syncMutex);
+        stopSync = true;
+    }
+    syncCv.notify_all();
+    if (syncThread.joinable()) syncThread.join();
+    if (memTable->getLength()) convertAndWriteMemTable(memTable);
     // slippery: 防止内存泄漏
     if (memTable) delete memTable;
+    if (options.syncMode != WalSyncMode::NONE) fdatasync(vlogFd);
+    closeVlog();
 }
 
 /**
@@ -32,23 +67,149 @@ KVStore::~KVStore() {
  * No return values for simplicity.
  */
 void KVStore::put(uint64_t key, const std::string &s) {
-    if (memTable->getLength() < memTableLenThreshold)
-        memTable->put(key, s);
-    else {
-        // length == threshold
-        if (memTable->get(key).has_value())
-            memTable->put(key, s);
-        else {
-            // memTable overflow, don't insert now
-            // #ifdef DET
-            //             std::cout << "memtable is full. Start to convert to
-            //                          sst.\n " << " At 'key' = " << key <<
-            //                          std::endl;
-            // #endif
-            convertAndWriteMemTable();
-            clearMemTable();
-            memTable->put(key, s);
+    VlogPointer ptr;
+    uint64_t generation;
+    {
+        // 常规路径: 多个写者在共享锁下并发写入无锁skiplist
+        // 并发写入时memTable可能略超过memTableBytes
+        // 持锁期间先写vlog再插入memTable，保证封存前后的offset有序
+        std::shared_lock<std::shared_mutex> lock(memMutex);
+        if (!memTableFull()) {
+            ptr = appendToVlog(key, s);
+            memTable->put(key, ptr);
+        } else {
+            lock.unlock();
+            // memTable已满，独占地封存后再插入
+            std::unique_lock<std::shared_mutex> uniqueLock(memMutex);
+            ptr = putWithoutLock(key, s, uniqueLock);
         }
+        generation = vlogGeneration;
+    }
+    // 不持memMutex等待落盘，避免阻塞封存
+    if (options.syncMode == WalSyncMode::BATCH)
+        syncVlog(ptr.offset + VLOG_ENTRY_HEADER_BYTENUM + ptr.vlen, generation);
+}
+// putWithoutLock - 调用者需持有memMutex的独占锁
+// memTable已满时将其封存为immMemTable交给后台线程flush，不在此处做I/O
+VlogPointer KVStore::putWithoutLock(uint64_t key, const std::string &s,
+                                    std::unique_lock<std::shared_mutex> &lock) {
+    while (memTableFull()) {
+        // memTable overflow, don't insert now
+        // 上一个immMemTable尚未写完时只能等待(背压)
+        if (immMemTable) {
+            flushCv.wait(lock, [this] { return immMemTable == nullptr; });
+            continue;
+        }
+        sealMemTable();
+    }
+    VlogPointer ptr = appendToVlog(key, s);
+    memTable->put(key, ptr);
+    return ptr;
+}
+// sealMemTable - 调用者需持有memMutex的独占锁，且immMemTable为空
+void KVStore::sealMemTable() {
+    immMemTable = memTable;
+    memTable = newMemTable();
+    flushCv.notify_all();
+}
+// appendToVlog - value立即追加到vlog末尾(vlog兼作WAL)，返回其位置
+// 压缩在vlogMutex外完成; vlen与checksum针对实际写入(可能压缩后)的字节
+VlogPointer KVStore::appendToVlog(uint64_t key, const std::string &s) {
+    SS_VLEN_TL vlen = s == DELETE_MARK ? 0 : s.length();
+    std::string compressed;
+    bool isCompressed = vlen >= VLOG_COMPRESS_MIN_BYTENUM &&
+                        vlogcodec::compress(options.vlogCompression, s,
+                                            compressed);
+    const std::string &val = isCompressed ? compressed : vlen ? s : "";
+    if (isCompressed) vlen = compressed.size();
+    VLOG_MAGIC_TL magic =
+        isCompressed ? VLOG_COMPRESSED_MAGIC_VAL : VLOG_DEFAULT_MAGIC_VAL;
+    VLOG_CHECKSUM_TL checksum = calcChecksum(key, vlen, val);
+    std::lock_guard<std::mutex> lock(vlogMutex);
+    VlogPointer ptr{head, vlen};
+    if (writeVlogEntry(vlogFd, head, magic, checksum, key, vlen, val))
+        head += VLOG_ENTRY_HEADER_BYTENUM + vlen;
+    return ptr;
+}
+// syncVlog - group commit: 等待vlog中end之前的内容落盘
+// 同一时刻只有一个线程(leader)执行fdatasync，它覆盖此前所有已写入的entry，
+// 其余线程等待该次fdatasync完成后直接返回
+// generation与end取自同一次写入; 其间发生reset时vlog已被删除，直接返回
+void KVStore::syncVlog(SS_OFFSET_TL end, uint64_t generation) {
+    std::unique_lock<std::mutex> lock(syncMutex);
+    while (generation == vlogGeneration && syncedHead < end) {
+        if (syncing) {
+            syncCv.wait(lock);
+            continue;
+        }
+        syncing = true;
+        SS_OFFSET_TL target;
+        {
+            std::lock_guard<std::mutex> vlogLock(vlogMutex);
+            target = head;
+        }
+        lock.unlock();
+        if (fdatasync(vlogFd)) perror("fdatasync");
+        lock.lock();
+        syncing = false;
+        syncedHead = std::max(syncedHead, target);
+        syncCv.notify_all();
+    }
+}
+void KVStore::syncLoop() {
+    std::unique_lock<std::mutex> lock(syncMutex);
+    while (!stopSync) {
+        syncCv.wait_for(lock,
+                        std::chrono::milliseconds(options.syncIntervalMs),
+                        [this] { return stopSync; });
+        SS_OFFSET_TL target;
+        {
+            std::lock_guard<std::mutex> vlogLock(vlogMutex);
+            target = head;
+        }
+        if (target <= syncedHead || syncing) continue;
+        syncing = true;
+        lock.unlock();
+        if (fdatasync(vlogFd)) perror("fdatasync");
+        lock.lock();
+        syncing = false;
+        syncedHead = std::max(syncedHead, target);
+        syncCv.notify_all();
+    }
+}
+void KVStore::openVlog() {
+    vlogFd = open(vlog.c_str(), O_WRONLY | O_CREAT, 0644);
+    vlogReadFd = open(vlog.c_str(), O_RDONLY);
+    if (vlogFd < 0 || vlogReadFd < 0)
+        std::cerr << "Failed to open vlogFile: " + vlog + "\n";
+}
+void KVStore::closeVlog() {
+    if (vlogFd >= 0) close(vlogFd), vlogFd = -1;
+    if (vlogReadFd >= 0) close(vlogReadFd), vlogReadFd = -1;
+}
+// flushMemTableSync - 封存当前memTable并等待后台线程写完
+void KVStore::flushMemTableSync(std::unique_lock<std::shared_mutex> &lock) {
+    flushCv.wait(lock, [this] { return immMemTable == nullptr; });
+    if (!memTable->getLength()) return;
+    sealMemTable();
+    flushCv.wait(lock, [this] { return immMemTable == nullptr; });
+}
+void KVStore::flushLoop() {
+    std::unique_lock<std::shared_mutex> lock(memMutex);
+    while (true) {
+        flushCv.wait(lock, [this] { return stopFlush || immMemTable; });
+        if (!immMemTable) break;  // stopFlush且无待写数据
+        memtable_type *table = immMemTable;
+        lock.unlock();
+        // immMemTable只读，flush期间读写memTable均不受阻塞;
+        // levelMutex只在替换levelCache中的元数据时短暂独占
+        convertAndWriteMemTable(table);
+        lock.lock();
+        // 数据已进入levelCache，之后的get不会再访问immMemTable
+        immMemTable = nullptr;
+        flushEpoch++;
+        delete table;
+        flushCv.notify_all();
     }
 }
 /**
@@ -58,12 +219,40 @@ void KVStore::put(uint64_t key, const std::string &s) {
 
 std::string KVStore::get(uint64_t key) {
     std::string retStr = "";
+    std::optional<VlogPointer> ptr;
+    // 读完value之前，gc不能在查到的offset处打洞
+    std::shared_lock<std::shared_mutex> readLock(vlogReadMutex);
+    {
+        std::shared_lock<std::shared_mutex> lock(memMutex);
+        ptr = getFromMemTables(key);
+    }
+    if (ptr.has_value())
+        return ptr->vlen ? getValueByOffsetnVlen(ptr->offset, ptr->vlen) : "";
+    // 先释放memMutex再查sst，避免后台flush持有levelMutex时阻塞封存
+    std::shared_lock<std::shared_mutex> levelLock(levelMutex);
     getValueOrOffset(key, retStr);
     return retStr;
 }
 
+// getFromMemTables - 依次查memTable/immMemTable，调用者需持有memMutex
+std::optional<VlogPointer> KVStore::getFromMemTables(uint64_t key) {
+    std::optional<VlogPointer> res = memTable->get(key);
+    if (!res.has_value() && immMemTable) res = immMemTable->get(key);
+    return res;
+}
+
+// getOffset - 只持共享锁，与get相同: 先释放memMutex再查sst
 void KVStore::getOffset(uint64_t key, SS_OFFSET_TL *userOffsetPtr) {
     std::string tmpStr = "";
+    {
+        std::shared_lock<std::shared_mutex> lock(memMutex);
+        std::optional<VlogPointer> ptr = getFromMemTables(key);
+        if (ptr.has_value()) {
+            *userOffsetPtr = ptr->offset;
+            return;
+        }
+    }
+    std::shared_lock<std::shared_mutex> levelLock(levelMutex);
     getValueOrOffset(key, tmpStr, userOffsetPtr);
 }
 /**
@@ -82,7 +271,16 @@ bool KVStore::del(uint64_t key) {
  * including memtable and all sstables files.
  */
 void KVStore::reset() {
+    std::lock_guard<std::mutex> gcLock(gcMutex);
+    std::unique_lock<std::shared_mutex> readLock(vlogReadMutex);
+    std::unique_lock<std::shared_mutex> lock(memMutex);
+    flushCv.wait(lock, [this] { return immMemTable == nullptr; });
+    std::unique_lock<std::shared_mutex> levelLock(levelMutex);
+    // 等待进行中的fdatasync结束，期间不允许再发起新的sync
+    std::unique_lock<std::mutex> syncLock(syncMutex);
+    syncCv.wait(syncLock, [this] { return !syncing; });
     clearMemTable();
+    closeVlog();
     // delete all SST & VLOG
     std::vector<std::string> nameList;
     int fileNum = utils::scanDir(dir, nameList);
@@ -103,24 +301,40 @@ void KVStore::reset() {
     }
     // delete cache
     levelCache.clear();
-    hashCachePtrByUid.clear();
-    ptrTracks.clear();
+    tableCache.clear();
 
     head = 0, tail = 0;
     // others
     largestUid = 0, largestTimeStamp = 0;
+    openVlog();
+    syncedHead = 0;
+    vlogGeneration++;
+    // 等待reset之前写入的entry落盘的写者不会再等到，唤醒它们返回
+    syncCv.notify_all();
 }
 
 /**
  * This reclaims space from vLog by moving valid value and discarding invalid
  * value. chunk_size is the size in byte you should AT LEAST recycle.
  */
+// chunk_size按entry header加未压缩的value长度计，与是否开启vlogCompression无关;
+// 否则压缩率高时一次gc要扫描、搬移成倍的entry
 void KVStore::gc(uint64_t chunk_size) {
+    std::lock_guard<std::mutex> gcLock(gcMutex);
     uint64_t scannedBytes = 0;
+    SS_OFFSET_TL oldTail = tail;
+    uint64_t epoch;
+    {
+        std::shared_lock<std::shared_mutex> lock(memMutex);
+        epoch = flushEpoch;
+    }
+    // 扫描只持共享锁(与get相同)，找出仍是最新的entry并读出value;
+    // 不阻塞put/get，也不在持有memMutex时等待后台compaction持有的levelMutex
+    std::vector<GcEntryProps> live;
     while (scannedBytes < chunk_size) {
         if (!checkTailCandidateValidity(tail)) {
             std::cerr << "ERR: `tail` is invaild\n";
-            return;
+            break;
         }
 
         std::ifstream vlogFile(vlog, std::ios::binary);
@@ -133,42 +347,85 @@ void KVStore::gc(uint64_t chunk_size) {
         SS_VLEN_TL curVlen;
         offsetRecord += SS_KEY_BYTENUM;
         readDataFromVlog(vlogFile, curVlen, offsetRecord);
+        VLOG_MAGIC_TL curMagic;
+        readDataFromVlog(vlogFile, curMagic, tail);
+        vlogFile.close();
+        uint64_t rawVlen = curVlen;
         if (sstOffsetRes == CONVENTIONAL_MISS_FLAG_OFFSET ||
             sstOffsetRes != tail) {
-            // not latest data. do nothing
+            // not latest data. do nothing; 压缩的value只读出原长
+            if (curMagic == VLOG_COMPRESSED_MAGIC_VAL) {
+                char codecHeader[VLOG_CODEC_HEADER_MAX_BYTENUM];
+                size_t n = std::min<size_t>(curVlen, sizeof(codecHeader));
+                if (pread(vlogReadFd, codecHeader, n,
+                          tail + VLOG_ENTRY_HEADER_BYTENUM) != (ssize_t)n ||
+                    !vlogcodec::rawLength(codecHeader, n, rawVlen))
+                    rawVlen = curVlen;
+            }
         } else {
-            // is latest data
-            std::string curValue;
-            offsetRecord += SS_VLEN_BYTENUM;
-            readValStringFromVlog(vlogFile, curValue, offsetRecord, curVlen);
-            put(curKey, curValue);
-        }
-
-        // dig hole
-        vlogFile.close();
-        SS_OFFSET_TL curEntryLen = VLOG_MAGIC_BYTENUM + VLOG_CHECKSUM_BYTENUM +
-                                   SS_KEY_BYTENUM + SS_VLEN_BYTENUM + curVlen;
-        if (utils::de_alloc_file(vlog, tail, curEntryLen)) {
-            std::cerr << "ERR: failed at de_ALLOC_FILE()\n";
-            return;
+            // is latest data; 压缩的value先解压，重新写入时按当前配置压缩
+            std::string curValue =
+                curVlen ? getValueByOffsetnVlen(tail, curVlen) : DELETE_MARK;
+            // 读不出value时不能搬移，本轮停在该entry之前，tail不越过它
+            if (curValue.empty()) {
+                std::cerr << "ERR: gc failed to read the value at " << tail
+                          << "\n";
+                break;
+            }
+            if (curVlen) rawVlen = curValue.size();
+            live.push_back({curKey, tail, std::move(curValue), false});
         }
         // 更新tail
-        tail += curEntryLen;
-        scannedBytes += curEntryLen;
+        tail += VLOG_ENTRY_HEADER_BYTENUM + curVlen;
+        scannedBytes += VLOG_ENTRY_HEADER_BYTENUM + rawVlen;
+    }
+    if (tail == oldTail) return;
+    // 重新写入前在memMutex的独占锁下比较offset(compare-and-set): 扫描之后的
+    // 写入只会在memTable/immMemTable中，除非其间有flush完成(flushEpoch变化)，
+    // 此时剩余entry释放锁后重新查找
+    size_t next = 0;
+    while (true) {
+        std::unique_lock<std::shared_mutex> lock(memMutex);
+        for (; next < live.size() && flushEpoch == epoch; ++next) {
+            GcEntryProps &entry = live[next];
+            if (entry.stale) continue;
+            std::optional<VlogPointer> ptr = getFromMemTables(entry.key);
+            if (ptr.has_value() && ptr->offset != entry.offset) continue;
+            // 等待flush会释放memMutex，flush完成后重新确认该entry
+            if (memTableFull() && immMemTable) {
+                flushCv.wait(lock, [this] { return immMemTable == nullptr; });
+                break;
+            }
+            putWithoutLock(entry.key, entry.value, lock);
+        }
+        if (next == live.size()) break;
+        epoch = flushEpoch;
+        lock.unlock();
+        for (size_t i = next; i < live.size(); ++i) {
+            SS_OFFSET_TL offset = CONVENTIONAL_MISS_FLAG_OFFSET;
+            getOffset(live[i].key, &offset);
+            live[i].stale = offset != live[i].offset;
+        }
     }
-    if (memTable->getLength()) {
-        convertAndWriteMemTable();
-        clearMemTable();
+    // 被搬移的value须先落盘，才能在旧位置打洞; gcMutex保证其间没有reset
+    if (options.syncMode != WalSyncMode::NONE) {
+        SS_OFFSET_TL target;
+        {
+            std::lock_guard<std::mutex> vlogLock(vlogMutex);
+            target = head;
+        }
+        syncVlog(target, vlogGeneration);
+    }
+    // dig hole; 等待此前查到旧offset的读者读完
+    // [oldTail, tail)中的entry均已搬移或已失效; 读失败而停下的entry不在其中
+    std::unique_lock<std::shared_mutex> readLock(vlogReadMutex);
+    if (utils::de_alloc_file(vlog, oldTail, tail - oldTail)) {
+        std::cerr << "ERR: failed at de_ALLOC_FILE()\n";
     }
 }
 
 void KVStore::getValueOrOffset(uint64_t key, std::string &userStr,
                                SS_OFFSET_TL *userOffsetPtr) {
-    std::optional<std::string> res = memTable->get(key);
-    if (res.has_value()) {
-        userStr = res.value() != DELETE_MARK ? res.value() : "";
-        return;
-    }
     // #ifdef DET
     //     std::cout << "memtable miss. Go to SST to find " << key << "\n";
     // #endif
@@ -179,30 +436,49 @@ void KVStore::getValueOrOffset(uint64_t key, std::string &userStr,
             SS_TIMESTAMP_TL maxTimeStamp = 0;
             VALUE_TL ans = "";
             SS_OFFSET_TL offsetAns = CONVENTIONAL_MISS_FLAG_OFFSET;
-            for (auto itemIter = level.begin(); itemIter != level.end();
-                 ++itemIter) {
+            // 第0层的sst区间互相重叠，需逐个检查;
+            // 第1层起区间互不相交且按minKey有序，只有minKey <= key的最后一个
+            // sst可能含key，二分定位即可
+            auto first = level.begin(), last = level.end();
+            if (i) {
+                last = level.upper_bound(key);
+                first = last == level.begin() ? last : std::prev(last);
+            }
+            for (auto itemIter = first; itemIter != last; ++itemIter) {
                 auto &item = *itemIter;
                 if (key < item.second.minKey || key > item.second.maxKey)
                     continue;
-                FILE_NUM_TL curUid = item.second.uid;
-                sstInfoItemProps *sstInfoItemPtr = hashCachePtrByUid[curUid];
+                // filter常驻，不含key的sst不必读入entry数组
+                if (enableBf && !item.second.filter.query(key)) continue;
+                // entry数组不在tableCache中时只读sst中所需的block，
+                // 比读入整个sst便宜得多，也不把单次点查的sst挤进cache
+                std::shared_ptr<const CachedSST> cached =
+                    tableCache.lookup(item.second.uid);
+                SS_TIMESTAMP_TL timeStamp = item.second.timeStamp;
                 SSTEntryProps offsetRes =
-                    findOffsetInSSTInfoItemPtr(sstInfoItemPtr, key);
+                    cached ? findOffsetInCachedSST(*cached, key)
+                    : item.second.reader
+                        ? findOffsetInSSTReader(*item.second.reader, key)
+                        : findOffsetInSSTFile(sstFilePath(i, item.second.uid),
+                                              key, timeStamp);
                 if (offsetRes.offset == CONVENTIONAL_MISS_FLAG_OFFSET) {
                     // not found in this SST
                 } else {
                     // found in this SST
                     if (!offsetRes.vlen) {
-                        if (sstInfoItemPtr->timeStamp > maxTimeStamp) {
-                            maxTimeStamp = sstInfoItemPtr->timeStamp;
+                        if (timeStamp > maxTimeStamp) {
+                            maxTimeStamp = timeStamp;
                             ans = "";
                             offsetAns = offsetRes.offset;
                         }
                     } else {
-                        if (sstInfoItemPtr->timeStamp > maxTimeStamp) {
-                            maxTimeStamp = sstInfoItemPtr->timeStamp;
-                            ans = getValueByOffsetnVlen(offsetRes.offset,
-                                                        offsetRes.vlen);
+                        if (timeStamp > maxTimeStamp) {
+                            maxTimeStamp = timeStamp;
+                            // 只查offset(gc)时不读value
+                            ans = userOffsetPtr
+                                      ? ""
+                                      : getValueByOffsetnVlen(offsetRes.offset,
+                                                              offsetRes.vlen);
                             offsetAns = offsetRes.offset;
                         }
                     }
@@ -248,33 +524,24 @@ void KVStore::getValueOrOffset(uint64_t key, std::string &userStr,
                 int secondFileNum = utils::scanDir(dirPath, fileNameList);
                 for (int j = 0; j < secondFileNum; j++) {
                     std::string curFilePath = dirPath + "/" + fileNameList[j];
-                    sstInfoItemProps fileItem;
-                    readFileNGetFileItem(curFilePath, fileItem);
-                    std::string::size_type suffix_pos =
-                        fileNameList[j].rfind(SS_FILE_SUFFIX);
-                    if (suffix_pos != std::string::npos) {
-                        std::string numStr =
-                            fileNameList[j].substr(0, suffix_pos);
-                        FILE_NUM_TL num =
-                            static_cast<FILE_NUM_TL>(std::stoi(numStr));
-                        fileItem.uid = num;
-                    }
-                    // got fileItem
+                    SS_TIMESTAMP_TL timeStamp = 0;
                     SSTEntryProps offsetRes =
-                        findOffsetInSSTInfoItemPtr(&fileItem, key);
+                        findOffsetInSSTFile(curFilePath, key, timeStamp);
                     if (offsetRes.offset != CONVENTIONAL_MISS_FLAG_OFFSET) {
                         // found in this SST
                         if (!offsetRes.vlen) {
-                            if (fileItem.timeStamp > maxTimeStamp) {
-                                maxTimeStamp = fileItem.timeStamp;
+                            if (timeStamp > maxTimeStamp) {
+                                maxTimeStamp = timeStamp;
                                 ans = "";
                                 offsetAns = offsetRes.offset;
                             }
                         } else {
-                            if (fileItem.timeStamp > maxTimeStamp) {
-                                maxTimeStamp = fileItem.timeStamp;
-                                ans = getValueByOffsetnVlen(offsetRes.offset,
-                                                            offsetRes.vlen);
+                            if (timeStamp > maxTimeStamp) {
+                                maxTimeStamp = timeStamp;
+                                ans = userOffsetPtr
+                                          ? ""
+                                          : getValueByOffsetnVlen(
+                                                offsetRes.offset, offsetRes.vlen);
                                 offsetAns = offsetRes.offset;
                             }
                         }
@@ -313,280 +580,252 @@ void KVStore::fillCrcObj(std::vector<unsigned char> &crcObj, KEY_TYPE key,
         reinterpret_cast<const unsigned char *>(value.data());
     crcObj.insert(crcObj.end(), valuePtr, valuePtr + vlen);
 }
-void KVStore::convertAndWriteMemTable() {
-    // write to vLog
-    std::ofstream vlogFile(vlog, std::ios::binary | std::ios::app);
-    if (!vlogFile.is_open()) {
-        std::cerr << "Failed to open vlogFile: " + vlog + " for writing.\n";
-        return;
-    }
-    std::list<std::pair<KEY_TL, std::string>> list;
-    std::vector<SS_OFFSET_TL> offsetList;
-    std::vector<SS_VLEN_TL> vlenList;
-    memTable->scan(0, std::numeric_limits<uint64_t>::max(), list);
-
-    for (const auto &item : list) {
-        VLOG_MAGIC_TL magic = 0xff;
-        SS_VLEN_TL vlen;
-        VLOG_CHECKSUM_TL checksum;
-        if (item.second == DELETE_MARK) {
-            vlen = 0;
-            checksum = calcChecksum(item.first, vlen, "");
-        } else {
-            vlen = item.second.length();
-            checksum = calcChecksum(item.first, vlen, item.second);
-        }
-        // start writing
-        head = vlogFile.tellp();
-        offsetList.push_back(head);
-        vlenList.push_back(vlen);
-        if (item.second == DELETE_MARK) {
-            writeVlogEntry(vlogFile, magic, checksum, item.first, vlen, "");
-        } else
-            writeVlogEntry(vlogFile, magic, checksum, item.first, vlen,
-                           item.second);
-    }
-    head = vlogFile.tellp();
-    vlogFile.close();
-
-    // 根据key/offset/vlenList生成若干个sstFile
+// convertAndWriteMemTable - 由flush线程调用(构造与析构期间没有其他线程)，
+// 它是levelCache唯一的修改者; 生成、写出sst时至多持levelMutex的共享锁，
+// 只在新sst放入、旧sst移出levelCache时短暂持独占锁
+// value在put时已写入vlog，这里只需生成sst索引
+void KVStore::convertAndWriteMemTable(memtable_type *table) {
+    // 在flush线程里完成封存(如vector排序)，不占用memMutex
+    table->seal();
+    // 按key顺序遍历memTable，一趟内直接填充sst索引项
     std::vector<sstInfoItemProps> SSTList;
-    std::list<KEY_TL> keyList;
-    std::transform(
-        list.begin(), list.end(), std::back_inserter(keyList),
-        [](const std::pair<KEY_TL, std::string> &pair) { return pair.first; });
-#ifdef LAST_WA
-    if (!std::is_sorted(keyList.begin(), keyList.end())) {
-        auto it = std::adjacent_find(keyList.begin(), keyList.end(),
-                                     std::greater<KEY_TL>());
-        if (it != keyList.end()) {
-            std::cerr << "Error: keyList is not sorted. The pair (" << *it
-                      << ", " << *(std::next(it)) << ") is out of order.\n";
-        }
-    }
-#endif
-    generateSSTList(keyList, offsetList, vlenList, SSTList, ++largestTimeStamp);
+    generateSSTListFromMemTable(table, SSTList, ++largestTimeStamp);
 
     // write to SSTable.
     FILE_NUM_TL targetLevel = 0;
     // 首先写入硬盘
     writeSSTToDisk(targetLevel, SSTList);
+    std::vector<SSTMetaProps> metas;
+    for (auto &item : SSTList) metas.push_back(makeSSTMeta(targetLevel, item));
     // 接着写入缓存
     // slippery
-    writeSSTToCache(targetLevel, SSTList);
-
-    // 判断新增sst后，第0层是否溢出
-    while (levelCache[targetLevel].size() >
-           MAX_FILE_NUM_GIVEN_LEVEL(targetLevel)) {
-        // 从level0合并
-        ptrTracks.clear();
-        KEY_TL intervalMinKey, intervalMaxKey;
-        long MinTrackIndexOfSonLevel;
+    {
+        std::unique_lock<std::shared_mutex> levelLock(levelMutex);
+        for (auto &meta : metas) installSST(targetLevel, std::move(meta));
+    }
+    // levelCache只由本线程修改，读取时不必加锁
+    size_t levelNum = levelCache.size();
+    // 判断新增sst后，第0层是否溢出; sonLevel溢出则开启新一轮合并
+    while (compactLevel(targetLevel)) targetLevel++;
+    // 原来最深一层中未参与合并的sst不再是最深一层
+    if (levelCache.size() > levelNum) fillMissingFilters();
+}
+// compactLevel - 第targetLevel层溢出时，把多出的sst与下一层中区间重叠的sst
+// 归并进下一层，未溢出时返回false; 归并与写出新sst只持levelMutex的共享锁
+bool KVStore::compactLevel(FILE_NUM_TL targetLevel) {
+    FILE_NUM_TL sonLevel = targetLevel + 1;
+    std::vector<MergeTrack> tracks;
+    std::vector<SSTMetaProps> outputs;
+    {
+        std::shared_lock<std::shared_mutex> levelLock(levelMutex);
+        if (levelCache[targetLevel].size() <= maxFileNum(targetLevel))
+            return false;
+        // 各track只记录sst元数据，归并时才逐个读入
         if (!targetLevel) {
-            // 生成前3条归并track/指针
-            MinTrackIndexOfSonLevel = 3;
-            std::vector<KEY_TL> tmpMinKeyVector;
-            std::vector<KEY_TL> tmpMaxKeyVector;
-            for (int i = 0; i < 3; ++i) {
-                auto it = levelCache[targetLevel].begin();
-                std::advance(it, i);
-                std::vector<sstInfoItemProps> tmpVector = {(*it).second};
-                tmpMinKeyVector.push_back(tmpVector[0].minKey);
-                tmpMaxKeyVector.push_back(tmpVector[0].maxKey);
-                ptrTracks.push_back(PtrTrackProps(tmpVector));
-            }
-            intervalMinKey = *std::min_element(tmpMinKeyVector.begin(),
-                                               tmpMinKeyVector.end());
-            intervalMaxKey = *std::max_element(tmpMaxKeyVector.begin(),
-                                               tmpMaxKeyVector.end());
+            // 第0层的sst区间互相重叠，每个sst各生成一条归并track
+            for (auto &item : levelCache[targetLevel])
+                tracks.emplace_back(targetLevel,
+                                    std::vector<const SSTMetaProps *>{
+                                        &item.second});
         } else {
-            // 不是第0层，则本层只需生成1条归并track/指针
-            MinTrackIndexOfSonLevel = 1;
-            std::vector<sstInfoItemProps> reorderVec;
+            // 不是第0层，则本层只需生成1条归并track
+            std::vector<const SSTMetaProps *> reorderVec;
             for (auto &item : levelCache[targetLevel]) {
-                reorderVec.push_back(item.second);
+                reorderVec.push_back(&item.second);
             }
             std::sort(reorderVec.begin(), reorderVec.end(), compareReorderVec);
             FILE_NUM_TL fileNumToExpel = levelCache[targetLevel].size() -
-                                         MAX_FILE_NUM_GIVEN_LEVEL(targetLevel);
-            std::vector<sstInfoItemProps> tmpFileInfoList(
-                reorderVec.begin(), reorderVec.begin() + fileNumToExpel);
+                                         maxFileNum(targetLevel);
+            reorderVec.resize(fileNumToExpel);
             // SLIPPERY:
-            // tmpFileInfoList是放到track中去的,需要重新按key排序,若不排则为timestamp顺序
-            std::sort(tmpFileInfoList.begin(), tmpFileInfoList.end(),
-                      [](const sstInfoItemProps &a, const sstInfoItemProps &b) {
-                          return a.minKey < b.minKey;
+            // track中的sst需要重新按key排序,若不排则为timestamp顺序
+            std::sort(reorderVec.begin(), reorderVec.end(),
+                      [](const SSTMetaProps *a, const SSTMetaProps *b) {
+                          return a->minKey < b->minKey;
                       });
-            // slippery:
-            // [前后逻辑贯通]要做下一层的区间覆盖,要保证下一层区间不相交性.
-            auto minElement = *std::min_element(
-                tmpFileInfoList.begin(), tmpFileInfoList.end(),
-                [](const sstInfoItemProps &a, const sstInfoItemProps &b) {
-                    return a.minKey < b.minKey;
-                });
-            intervalMinKey = minElement.minKey;
-            auto maxElement = *std::max_element(
-                tmpFileInfoList.begin(), tmpFileInfoList.end(),
-                [](const sstInfoItemProps &a, const sstInfoItemProps &b) {
-                    return a.maxKey < b.maxKey;
-                });
-            intervalMaxKey = maxElement.maxKey;
-            if (!tmpFileInfoList.empty())
-                ptrTracks.push_back(PtrTrackProps(tmpFileInfoList));
+            tracks.emplace_back(targetLevel, std::move(reorderVec));
         }
-        // 生成第4条归并track/指针
-        FILE_NUM_TL sonLevel = targetLevel + 1;
-        if (levelCache.size() - 1 >= sonLevel &&
-            !levelCache[sonLevel].empty()) {
-            std::vector<sstInfoItemProps> tmpFileInfoList;
+        // slippery:
+        // [前后逻辑贯通]要做下一层的区间覆盖,要保证下一层区间不相交性.
+        KEY_TL intervalMinKey = std::numeric_limits<KEY_TL>::max(),
+               intervalMaxKey = 0;
+        SS_TIMESTAMP_TL maxTimeStampToWrite = 0;
+        for (auto &track : tracks)
+            for (const SSTMetaProps *meta : track.files) {
+                intervalMinKey = std::min(intervalMinKey, meta->minKey);
+                intervalMaxKey = std::max(intervalMaxKey, meta->maxKey);
+                maxTimeStampToWrite =
+                    std::max(maxTimeStampToWrite, meta->timeStamp);
+            }
+        // 下一层中与区间重叠的sst生成最后一条归并track
+        std::vector<const SSTMetaProps *> sonFiles;
+        bool sonExists = sonLevel < levelCache.size();
+        if (sonExists)
             for (auto &sonItem : levelCache[sonLevel]) {
                 if (sonItem.second.minKey <= intervalMaxKey &&
                     sonItem.second.maxKey >= intervalMinKey) {
-                    tmpFileInfoList.push_back(sonItem.second);
+                    sonFiles.push_back(&sonItem.second);
+                    maxTimeStampToWrite = std::max(maxTimeStampToWrite,
+                                                   sonItem.second.timeStamp);
                 }
             }
-            if (!tmpFileInfoList.empty())
-                ptrTracks.push_back(PtrTrackProps(tmpFileInfoList));
-        }
-        // 开始归并成新文件
-        SS_TIMESTAMP_TL maxTimeStampToWrite = 0;
-        for (auto &trackItem : ptrTracks) {
-            for (auto &sstInfoItem : trackItem.fileInfoList)
-                maxTimeStampToWrite =
-                    std::max(maxTimeStampToWrite, sstInfoItem.timeStamp);
-        }
-        std::list<KEY_TL> keyList;
-        std::vector<SS_OFFSET_TL> offsetList;
-        std::vector<SS_VLEN_TL> vlenList;
-        mergeFilesAndReturnKOVList(ptrTracks, keyList, offsetList, vlenList,
-                                   targetLevel);
-        // ptrTracks已组装完成，删除所有旧文件
-        long tmpTrackIndex = -1;
-        for (auto &trackItem : ptrTracks) {
-            tmpTrackIndex++;
-            for (auto &fileInfoItem : trackItem.fileInfoList) {
-                tmpTrackIndex < MinTrackIndexOfSonLevel
-                    ? deleteSSTInDisknCache(fileInfoItem.uid, targetLevel,
-                                            fileInfoItem.minKey)
-                    : deleteSSTInDisknCache(fileInfoItem.uid, sonLevel,
-                                            fileInfoItem.minKey);
-            }
-        }
-#ifdef LAST_WA
-        if (!std::is_sorted(keyList.begin(), keyList.end())) {
-            auto it = std::adjacent_find(keyList.begin(), keyList.end(),
-                                         std::greater<KEY_TL>());
-            if (it != keyList.end()) {
-                std::cerr
-                    << "Error: [in Merge()] keyList is not sorted. The pair ("
-                    << *it << ", " << *(std::next(it))
-                    << ") is out of order. visitInd: " << visitInd << "\n";
-            }
-        }
-#endif
-        // 将本地的K/O/V list写入disk&cache
-        writeKOVListToDiskAndCache(keyList, offsetList, vlenList, sonLevel,
-                                   maxTimeStampToWrite);
-        // 判断sonLevel的文件数是否达到上限，若达到上限则开启新一轮合并
-        targetLevel = sonLevel;
+        // 下一层为空时，删除标记不必再向下传递
+        bool dropDeleted = !sonExists || levelCache[sonLevel].empty();
+        if (!sonFiles.empty())
+            tracks.emplace_back(sonLevel, std::move(sonFiles));
+        // 开始归并成新文件，边归并边写出; 期间读者仍使用旧sst
+        mergeTracksIntoLevel(tracks, sonLevel, maxTimeStampToWrite,
+                             dropDeleted, outputs);
+    }
+    // 旧sst先记下位置: 放入新sst可能扩充levelCache，之后不再经由track中的指针访问
+    std::vector<std::tuple<FILE_NUM_TL, FILE_NUM_TL, KEY_TL>> oldFiles;
+    for (auto &track : tracks)
+        for (const SSTMetaProps *meta : track.files)
+            oldFiles.emplace_back(track.level, meta->uid, meta->minKey);
+    tracks.clear();
+    {
+        // 一次性以新sst替换旧sst，读者不会看到归并到一半的状态
+        std::unique_lock<std::shared_mutex> levelLock(levelMutex);
+        for (auto &meta : outputs) installSST(sonLevel, std::move(meta));
+        for (auto &[level, uid, minKey] : oldFiles)
+            eraseSSTFromCache(uid, level, minKey);
     }
+    // 旧sst已不在levelCache中，之后的查找不会再打开它们; 已建立的映射在删除后仍有效
+    for (auto &[level, uid, minKey] : oldFiles) removeSSTFile(uid, level);
+    return true;
 }
 
-void KVStore::writeVlogEntry(std::ofstream &vlogFile,
+// writeVlogEntry - 将一条entry一次性写到vlog的offset处
+bool KVStore::writeVlogEntry(int vlogFd, SS_OFFSET_TL offset,
                              const VLOG_MAGIC_TL &magic,
                              const VLOG_CHECKSUM_TL &checksum,
                              const KEY_TL &key, const SS_VLEN_TL &vlen,
                              const VALUE_TL &val) {
-    const char *datap = reinterpret_cast<const char *>(&magic);
-    vlogFile.write(datap, sizeof(magic));
-    datap = reinterpret_cast<const char *>(&checksum);
-    vlogFile.write(datap, sizeof(checksum));
-    datap = reinterpret_cast<const char *>(&key);
-    vlogFile.write(datap, sizeof(key));
-    datap = reinterpret_cast<const char *>(&vlen);
-    vlogFile.write(datap, sizeof(vlen));
-    datap = val.data();
-    vlogFile.write(datap, vlen);
-}
-void KVStore::writeSSTEntry(std::ofstream &sstFile, const KEY_TL &key,
-                            const SS_OFFSET_TL &offset,
-                            const SS_VLEN_TL &vlen) {
-    sstFile.write(reinterpret_cast<const char *>(&key), sizeof(key));
-    sstFile.write(reinterpret_cast<const char *>(&offset), sizeof(offset));
-    sstFile.write(reinterpret_cast<const char *>(&vlen), sizeof(vlen));
+    std::string buffer;
+    buffer.reserve(VLOG_ENTRY_HEADER_BYTENUM + vlen);
+    buffer.append(reinterpret_cast<const char *>(&magic), sizeof(magic));
+    buffer.append(reinterpret_cast<const char *>(&checksum), sizeof(checksum));
+    buffer.append(reinterpret_cast<const char *>(&key), sizeof(key));
+    buffer.append(reinterpret_cast<const char *>(&vlen), sizeof(vlen));
+    buffer.append(val.data(), vlen);
+    if (pwrite(vlogFd, buffer.data(), buffer.size(), offset) !=
+        (ssize_t)buffer.size()) {
+        perror("pwrite");
+        return false;
+    }
+    return true;
 }
 
-void KVStore::readFileNGetFileItem(std::string filePath,
-                                   sstInfoItemProps &fileItem) {
-    std::ifstream file(filePath, std::ios::binary);
-    if (!file) {
+// readSSTMeta - 打开时只读header、filter与footer，不解码entry;
+// entry在第一次scan或合并时才读入。vlogEnd取自footer，
+// 旧格式与version 1的sst没有记录，才解码entry计算
+// 文件无法打开、格式未知或entry损坏时返回false
+bool KVStore::readSSTMeta(const std::string &filePath, FILE_NUM_TL uid,
+                          SSTMetaProps &meta, SS_OFFSET_TL &vlogEnd) {
+    auto reader = std::make_shared<SSTReader>();
+    if (!reader->open(filePath)) {
         std::cerr << "Failed to open file: " << filePath << std::endl;
-        return;
+        return false;
     }
-    // read bf
-    readBFFromSST(file, fileItem.bf);
-    // read kvNum&level
-    SSTHeaderProps headerProps;
-    readHeaderPropsFromSST(file, headerProps);
-    fileItem.kvNum = headerProps.kvNum;
-    fileItem.timeStamp = headerProps.timestamp;
-    fileItem.minKey = headerProps.minKey;
-    fileItem.maxKey = headerProps.maxKey;
-    // read 3 lists
-    for (SST_HEADER_KVNUM_TL i = 0; i < fileItem.kvNum; i++) {
-        SSTEntryProps entry;
-        readEntryFromSST(file, entry, i);
-        fileItem.keyList[i] = entry.key;
-        fileItem.offsetList[i] = entry.offset;
-        fileItem.vlenList[i] = entry.vlen;
+    if (!reader->vlogEnd(vlogEnd)) {
+        sstInfoItemProps fileItem;
+        if (!readEntriesFromSST(*reader, fileItem)) {
+            std::cerr << "ERR: invalid entries in sst\n";
+            return false;
+        }
+        vlogEnd = 0;
+        for (SST_HEADER_KVNUM_TL k = 0; k < fileItem.kvNum; k++)
+            vlogEnd = std::max(vlogEnd, fileItem.offsetList[k] +
+                                            VLOG_ENTRY_HEADER_BYTENUM +
+                                            fileItem.vlenList[k]);
     }
-    file.close();
-}
-
-void KVStore::readHeaderPropsFromSST(std::ifstream &file,
-                                     SSTHeaderProps &headerProps) {
-    file.seekg(0);
-    char buffer[SS_HEADER_BYTENUM];  // bytes
-    file.read(buffer, SS_TIMESTAMP_BYTENUM);
-    headerProps.timestamp = *reinterpret_cast<SS_TIMESTAMP_TL *>(buffer);
-    file.read(buffer, SS_KVNUM_BYTENUM);
-    headerProps.kvNum = *reinterpret_cast<SST_HEADER_KVNUM_TL *>(buffer);
-    file.read(buffer, SS_KEY_BYTENUM);
-    headerProps.minKey = *reinterpret_cast<KEY_TL *>(buffer);
-    file.read(buffer, SS_KEY_BYTENUM);
-    headerProps.maxKey = *reinterpret_cast<KEY_TL *>(buffer);
+    meta.uid = uid;
+    meta.timeStamp = reader->timeStamp;
+    meta.kvNum = reader->kvNum;
+    meta.minKey = reader->minKey;
+    meta.maxKey = reader->maxKey;
+    // filter直接指向映射，与reader一同常驻在元数据中
+    reader->readFilter(meta.filter, meta.rangeFilter);
+    meta.reader = std::move(reader);
+    return true;
 }
-void KVStore::readBFFromSST(std::ifstream &file, BF &bf) {
-    file.seekg(SS_HEADER_BYTENUM);
-    char buffer[SS_BLOOM_BYTENUM];  // bytes
-    file.read(buffer, SS_BLOOM_BYTENUM);
-    // fill into bf.bitArray
-    for (int i = 0; i < SS_BLOOM_BYTENUM; ++i) {
-        for (int j = 0; j < 8; ++j) {
-            bf.bitArray[i * 8 + j] = (buffer[i] & (1 << (7 - j))) != 0;
-        }
+// fillFileItemFromSST - header取自映射，entry解码后填入三个数组;
+// filter已常驻在levelCache中，这里不解析; entry损坏时返回false
+bool KVStore::fillFileItemFromSST(const SSTReader &reader,
+                                  sstInfoItemProps &fileItem) {
+    fileItem.kvNum = reader.kvNum;
+    fileItem.timeStamp = reader.timeStamp;
+    fileItem.minKey = reader.minKey;
+    fileItem.maxKey = reader.maxKey;
+    if (!reader.readLearnedIndex(fileItem.learnedIndex)) {
+        std::cerr << "ERR: invalid learned index in sst\n";
+        fileItem.learnedIndex = LearnedIndex();
+    }
+    if (!reader.readHashIndex(fileItem.hashIndex)) {
+        std::cerr << "ERR: invalid hash index in sst\n";
+        fileItem.hashIndex = HashIndex();
     }
+    if (!readEntriesFromSST(reader, fileItem)) {
+        std::cerr << "ERR: invalid entries in sst\n";
+        fileItem.resizeEntries(0);
+        return false;
+    }
+    return true;
 }
-void KVStore::readEntryFromSST(std::ifstream &file, SSTEntryProps &entry,
-                               int entryIndex) {
-    file.seekg(SS_HEADER_BYTENUM + SS_BLOOM_BYTENUM +
-               SS_ENTRY_BYTENUM * entryIndex);
-    char buffer[SS_ENTRY_BYTENUM];  // bytes
-    file.read(buffer, SS_KEY_BYTENUM);
-    entry.key = *reinterpret_cast<KEY_TL *>(buffer);
-    file.read(buffer, SS_OFFSET_BYTENUM);
-    entry.offset = *reinterpret_cast<SS_OFFSET_TL *>(buffer);
-    file.read(buffer, SS_VLEN_BYTENUM);
-    entry.vlen = *reinterpret_cast<SS_VLEN_TL *>(buffer);
+bool KVStore::readEntriesFromSST(const SSTReader &reader,
+                                 sstInfoItemProps &fileItem) {
+    if (!reader.isBlockFormat()) {
+        // 旧格式: entry定长平铺在bloom之后，map时已核对过文件大小
+        fileItem.resizeEntries(reader.kvNum);
+        for (SST_HEADER_KVNUM_TL i = 0; i < fileItem.kvNum; i++)
+            reader.legacyEntry(i, fileItem.keyList[i], fileItem.offsetList[i],
+                               fileItem.vlenList[i]);
+        return true;
+    }
+    std::vector<sstblock::IndexEntry> index;
+    if (!reader.readIndex(index)) return false;
+    // header中的kvNum未经校验，不据此分配，按实际解码出的entry追加后再核对
+    fileItem.resizeEntries(0);
+    sstblock::BlockReader blockReader;
+    for (auto &entry : index) {
+        if (!reader.openBlock(entry, blockReader)) return false;
+        bool ok = blockReader.forEach(
+            [&](KEY_TL key, SS_OFFSET_TL offset, SS_VLEN_TL vlen) {
+                fileItem.keyList.push_back(key);
+                fileItem.offsetList.push_back(offset);
+                fileItem.vlenList.push_back(vlen);
+            });
+        if (!ok) return false;
+    }
+    fileItem.kvNum = fileItem.keyList.size();
+    return fileItem.kvNum == reader.kvNum;
 }
 // findOffsetInCacheItem - 根据key在cacheItem中寻找vlogOffset
 // 若找不到，返回{xxx,CONVENTIONAL_MISS_FLAG_OFFSET,xxx}
 KVStore::SSTEntryProps KVStore::findOffsetInSSTInfoItemPtr(
-    KVStore::sstInfoItemProps *sstInfoItemPtr, KEY_TL key) {
+    const KVStore::sstInfoItemProps *sstInfoItemPtr, KEY_TL key) {
     KVStore::SSTEntryProps entry(0, CONVENTIONAL_MISS_FLAG_OFFSET, 0);
-    if (enableBf && !(sstInfoItemPtr->bf.query(key))) return entry;
+    // hash index只需O(1)次探测，优先于Eytzinger与二分
+    if (!sstInfoItemPtr->hashIndex.empty()) {
+        int pos = sstInfoItemPtr->hashIndex.find(key,
+                                                 sstInfoItemPtr->keyList.data());
+        if (pos >= 0)
+            entry.key = key, entry.offset = sstInfoItemPtr->offsetList[pos],
+            entry.vlen = sstInfoItemPtr->vlenList[pos];
+        return entry;
+    }
+    if (!sstInfoItemPtr->eytzinger.empty()) {
+        int pos = sstInfoItemPtr->eytzinger.find(key);
+        if (pos >= 0)
+            entry.key = key, entry.offset = sstInfoItemPtr->offsetList[pos],
+            entry.vlen = sstInfoItemPtr->vlenList[pos];
+        return entry;
+    }
     // start binary search
-    int left = 0, right = (sstInfoItemPtr->kvNum) - 1;
+    // 有learned index时只需在预测位置附近查找
+    int left, right;
+    sstInfoItemPtr->learnedIndex.searchRange(key, sstInfoItemPtr->kvNum, left,
+                                             right);
     while (left <= right) {
         int mid = (left + right) / 2;
         KEY_TL midKey = sstInfoItemPtr->keyList[mid];
@@ -602,19 +841,71 @@ KVStore::SSTEntryProps KVStore::findOffsetInSSTInfoItemPtr(
     }
     return entry;
 }
+// findOffsetInCachedSST - 压缩表示直接在Elias-Fano上查找，不解压整个sst
+KVStore::SSTEntryProps KVStore::findOffsetInCachedSST(const CachedSST &cached,
+                                                      KEY_TL key) {
+    if (cached.plain) return findOffsetInSSTInfoItemPtr(cached.plain.get(), key);
+    KVStore::SSTEntryProps entry(0, CONVENTIONAL_MISS_FLAG_OFFSET, 0);
+    if (cached.succinct.find(key, entry.offset, entry.vlen)) entry.key = key;
+    return entry;
+}
+// findOffsetInSSTFile - 不经cache直接打开sst文件查找key，用于禁用cache时;
+// 只用一次pread读header判断key范围，范围内才映射文件
+KVStore::SSTEntryProps KVStore::findOffsetInSSTFile(
+    const std::string &filePath, KEY_TL key, SS_TIMESTAMP_TL &timeStamp) {
+    KVStore::SSTEntryProps entry(0, CONVENTIONAL_MISS_FLAG_OFFSET, 0);
+    SSTReader reader;
+    if (!reader.openHeader(filePath)) {
+        std::cerr << "Failed to open file: " << filePath << std::endl;
+        return entry;
+    }
+    timeStamp = reader.timeStamp;
+    if (key < reader.minKey || key > reader.maxKey || !reader.map())
+        return entry;
+    return findOffsetInSSTReader(reader, key);
+}
+// findOffsetInSSTReader - 在常驻的映射上原地查找，只访问index与一个data block
+KVStore::SSTEntryProps KVStore::findOffsetInSSTReader(const SSTReader &reader,
+                                                      KEY_TL key) {
+    KVStore::SSTEntryProps entry(0, CONVENTIONAL_MISS_FLAG_OFFSET, 0);
+    if (reader.find(key, entry.offset, entry.vlen)) entry.key = key;
+    return entry;
+}
+// getValueByOffsetnVlen - 连同entry header一次读出，magic带压缩标记时就地解压
+// 调用者需持有vlogReadMutex的共享锁(gc扫描tail时除外: 只有gc自己在tail打洞);
+// magic、vlen或checksum对不上(如已被打洞)时视为未找到
 std::string KVStore::getValueByOffsetnVlen(SS_OFFSET_TL offset,
                                            SS_VLEN_TL vlen) {
-    std::ifstream file(vlog, std::ios::binary);
-    if (!file) {
-        std::cerr << "Failed to open file: " << vlog << std::endl;
+    std::string entry(VLOG_ENTRY_HEADER_BYTENUM + vlen, '\0');
+    if (pread(vlogReadFd, entry.data(), entry.size(), offset) !=
+        (ssize_t)entry.size()) {
+        std::cerr << "Failed to read file: " << vlog << std::endl;
+        return "";
+    }
+    VLOG_CHECKSUM_TL checksum;
+    KEY_TL key;
+    SS_VLEN_TL entryVlen;
+    std::memcpy(&checksum, entry.data() + VLOG_MAGIC_BYTENUM, sizeof(checksum));
+    std::memcpy(&key, entry.data() + VLOG_MAGIC_BYTENUM + VLOG_CHECKSUM_BYTENUM,
+                sizeof(key));
+    std::memcpy(&entryVlen,
+                entry.data() + VLOG_MAGIC_BYTENUM + VLOG_CHECKSUM_BYTENUM +
+                    SS_KEY_BYTENUM,
+                sizeof(entryVlen));
+    if (!IS_VLOG_MAGIC(VLOG_MAGIC_TL(entry[0])) || entryVlen != vlen ||
+        !crcCheck(checksum, key, vlen,
+                  entry.substr(VLOG_ENTRY_HEADER_BYTENUM))) {
+        std::cerr << "ERR: invalid vlog entry at " << offset << "\n";
+        return "";
+    }
+    if (VLOG_MAGIC_TL(entry[0]) != VLOG_COMPRESSED_MAGIC_VAL)
+        return entry.substr(VLOG_ENTRY_HEADER_BYTENUM);
+    std::string value;
+    if (!vlogcodec::decompress(entry.data() + VLOG_ENTRY_HEADER_BYTENUM, vlen,
+                               value)) {
+        std::cerr << "ERR: invalid compressed value at " << offset << "\n";
         return "";
     }
-    file.seekg(offset + VLOG_MAGIC_BYTENUM + VLOG_CHECKSUM_BYTENUM +
-               SS_KEY_BYTENUM + SS_VLEN_BYTENUM);  // slippery
-    char buffer[vlen + 1];
-    file.read(buffer, vlen);
-    buffer[vlen] = '\0';
-    std::string value(buffer, vlen);
     return value;
 }
 template <typename T>
@@ -656,10 +947,11 @@ VLOG_CHECKSUM_TL KVStore::calcChecksum(const KEY_TL &curKey,
     fillCrcObj(crcObj, curKey, curVlen, curValue);
     return utils::crc16(crcObj);
 }
-void KVStore::deleteSSTInDisknCache(FILE_NUM_TL uid, FILE_NUM_TL level,
-                                    KEY_TL minKey) {
-    // delete in levelCache & hashCachePtrByUid
-    hashCachePtrByUid.erase(uid);
+// eraseSSTFromCache - 调用者需持有levelMutex的独占锁
+void KVStore::eraseSSTFromCache(FILE_NUM_TL uid, FILE_NUM_TL level,
+                                KEY_TL minKey) {
+    // delete in levelCache & tableCache
+    tableCache.erase(uid);
     for (auto it = levelCache[level].begin(); it != levelCache[level].end();) {
         if (it->first == minKey && it->second.uid == uid) {
             it = levelCache[level].erase(it);
@@ -667,7 +959,9 @@ void KVStore::deleteSSTInDisknCache(FILE_NUM_TL uid, FILE_NUM_TL level,
             ++it;
         }
     }
-    // delete in disk
+}
+// removeSSTFile - sst须已移出levelCache，不需持有levelMutex
+void KVStore::removeSSTFile(FILE_NUM_TL uid, FILE_NUM_TL level) {
     if (utils::rmfile(dir + SS_DIR_PATH_SUFFIX_WITHOUT_LEVELNUM +
                       std::to_string(level) + "/" + std::to_string(uid) +
                       SS_FILE_SUFFIX)) {
@@ -677,92 +971,84 @@ void KVStore::deleteSSTInDisknCache(FILE_NUM_TL uid, FILE_NUM_TL level,
                          SS_FILE_SUFFIX
                   << " during compaction\n";
     }
-    return;
 }
 
-void KVStore::mergeFilesAndReturnKOVList(std::vector<PtrTrackProps> &ptrTracks,
-                                         std::list<KEY_TL> &keyList,
-                                         std::vector<SS_OFFSET_TL> &offsetList,
-                                         std::vector<SS_VLEN_TL> &vlenList,
-                                         FILE_NUM_TL targetLevel) {
-    visitInd++;
-    std::priority_queue<TrackPointerProps, std::vector<TrackPointerProps>,
-                        CompareForPointerQueue>
-        pointerQueue;
-    for (size_t tmpTrackIndex = 0; tmpTrackIndex < ptrTracks.size();
-         tmpTrackIndex++) {
-        pointerQueue.push(TrackPointerProps(0, 0, tmpTrackIndex));
-    }
-    while (!pointerQueue.empty()) {
-        TrackPointerProps topPointer = pointerQueue.top();
-        pointerQueue.pop();
-        sstInfoItemProps *topFilePtr =
-            &(ptrTracks[topPointer.trackIndex]
-                  .fileInfoList[topPointer.fileIndex]);
-        size_t topEntryIndex = topPointer.CacheItemIndex;
-        // 使所有可能的key相同的pointer右移
-        // slippery: 注意不要漏写右移逻辑
-        KEY_TL topKey = topFilePtr->keyList[topEntryIndex];
-        while (!pointerQueue.empty() &&
-               ptrTracks[pointerQueue.top().trackIndex]
-                       .fileInfoList[pointerQueue.top().fileIndex]
-                       .keyList[pointerQueue.top().CacheItemIndex] == topKey) {
-#ifdef WA
-            std::cout << "topTimeStamp: " << topFilePtr->timeStamp
-                      << ",expellingTimeStamp: "
-                      << ptrTracks[pointerQueue.top().trackIndex]
-                             .fileInfoList[pointerQueue.top().fileIndex]
-                             .timeStamp
-                      << "\n";
-#endif
-            TrackPointerProps expelledPointer = pointerQueue.top();
-            sstInfoItemProps *expelledFilePtr =
-                &(ptrTracks[expelledPointer.trackIndex]
-                      .fileInfoList[expelledPointer.fileIndex]);
-            bool controlFlag = 0;
-            pointerQueue.pop();
-            // update `expelledPointer`
-            expelledPointer.CacheItemIndex++;
-            if (expelledPointer.CacheItemIndex == expelledFilePtr->kvNum) {
-                // 尝试跳到该track的下一个文件
-                expelledPointer.CacheItemIndex = 0;
-                expelledPointer.fileIndex++;
-                if (ptrTracks[expelledPointer.trackIndex].fileInfoList.size() -
-                        1 >=
-                    expelledPointer.fileIndex) {
-                } else {
-                    // 该track已遍历完成，不push
-                    controlFlag = 1;
-                }
-            }
-            if (!controlFlag) pointerQueue.push(expelledPointer);
+bool KVStore::MergeTrack::open(KVStore &store) {
+    for (pos = 0; fileIndex < files.size(); fileIndex++) {
+        // 参与合并的sst随后即被删除，不放入tableCache
+        table = store.loadSST(level, *files[fileIndex], false);
+        if (table->kvNum) return true;
+    }
+    table.reset();
+    return false;
+}
+bool KVStore::MergeTrack::next(KVStore &store) {
+    if (++pos < table->kvNum) return true;
+    fileIndex++;
+    return open(store);
+}
+KVStore::CompactionIterator::CompactionIterator(KVStore &store,
+                                                std::vector<MergeTrack> &tracks)
+    : store(store), tracks(tracks), tree(tracks.size()) {
+    for (size_t i = 0; i < tracks.size(); i++)
+        if (tracks[i].open(store))
+            tree.set(i, tracks[i].key(), tracks[i].offset());
+    tree.build();
+}
+// next - 使所有与当前key相同的track右移，胜者即为下一个key的最新entry
+void KVStore::CompactionIterator::next() {
+    KEY_TL lastKey = key();
+    while (!tree.empty() && tree.topKey() == lastKey) {
+        MergeTrack &track = tracks[tree.top()];
+        if (track.next(store))
+            tree.replaceTop(track.key(), track.offset());
+        else
+            tree.popTop();
+    }
+}
+// mergeTracksIntoLevel - 流式归并tracks，每凑满sstEntryNum个entry即写出一个sst
+// 内存中只有各track当前的输入sst与一个正在填充的输出sst，与合并规模无关
+// 写出的sst只生成元数据放入outputs，由调用者在独占锁下放入levelCache
+void KVStore::mergeTracksIntoLevel(std::vector<MergeTrack> &tracks,
+                                   FILE_NUM_TL sonLevel,
+                                   SS_TIMESTAMP_TL timestampToWrite,
+                                   bool dropDeleted,
+                                   std::vector<SSTMetaProps> &outputs) {
+    double bitsPerKey = filterBitsPerKey(sonLevel);
+    std::vector<sstInfoItemProps> SSTList;
+    auto finishSST = [&]() {
+        sstInfoItemProps &item = SSTList.back();
+        item.buildFilter(options.filterType, bitsPerKey);
+        item.buildRangeFilter(options.rangeBitsPerKey);
+        item.buildLearnedIndex(options.learnedIndex);
+        item.buildHashIndex(hashIndexAt(sonLevel));
+        writeSSTToDisk(sonLevel, SSTList);
+        outputs.push_back(makeSSTMeta(sonLevel, item));
+        SSTList.clear();
+    };
+    for (CompactionIterator iter(*this, tracks); iter.valid(); iter.next()) {
+        if (dropDeleted && !iter.vlen()) continue;
+        KEY_TL key = iter.key();
+        if (SSTList.empty()) {
+            sstInfoItemProps &item = SSTList.emplace_back();
+            item.uid = ++largestUid;
+            item.timeStamp = timestampToWrite;
+            item.kvNum = 0;
+            item.minKey = key;
         }
-        SS_VLEN_TL vlenToInsert = topFilePtr->vlenList[topEntryIndex];
-        bool nextLevelEmpty = levelCache.size() - 1 < targetLevel + 1 ||
-                              levelCache[targetLevel + 1].empty();
-        // if (!(!vlenToInsert && nextLevelEmpty)) {
-        if (vlenToInsert || !nextLevelEmpty) {
-            keyList.push_back(topKey);
-            offsetList.push_back(topFilePtr->offsetList[topEntryIndex]);
-            vlenList.push_back(vlenToInsert);
+        sstInfoItemProps &cur = SSTList.back();
+        if (WATCHED_KEY && key == WATCHED_KEY) {
+            std::cout << "WATCHED_KEY in sstuid: " << cur.uid
+                      << " offset: " << iter.offset()
+                      << " timestamp: " << timestampToWrite << " \n";
         }
-
-        // update this pointer
-        topPointer.CacheItemIndex++;
-        if (topPointer.CacheItemIndex == topFilePtr->kvNum) {
-            // 尝试跳到该track的下一个文件
-            topPointer.CacheItemIndex = 0;
-            topPointer.fileIndex++;
-            if (ptrTracks[topPointer.trackIndex].fileInfoList.size() - 1 >=
-                topPointer.fileIndex) {
-            } else {
-                // 该track已遍历完成，不push
-                continue;
-            }
-        }
-        pointerQueue.push(topPointer);
+        cur.keyList.push_back(key);
+        cur.offsetList.push_back(iter.offset());
+        cur.vlenList.push_back(iter.vlen());
+        cur.maxKey = key;
+        if (++cur.kvNum == sstEntryNum) finishSST();
     }
-    // 优先队列已空，归并结束
+    if (!SSTList.empty()) finishSST();
 }
 
 void KVStore::writeSSTToDisk(FILE_NUM_TL level,
@@ -775,24 +1061,11 @@ void KVStore::writeSSTToDisk(FILE_NUM_TL level,
                     newFileName = std::to_string(curP->uid) + SS_FILE_SUFFIX,
                     newFilePath = targetPath + "/" + newFileName;
         if (!utils::dirExists(targetPath)) utils::_mkdir(targetPath);
-        // try to open sstFile
-        std::fstream fileCheck(newFilePath);
-        if (!fileCheck) {
-            // The file does not exist, create a new one.
-            std::ofstream newFile(newFilePath);
-            if (!newFile) {
-                std::cerr << "Failed to create the file: " << newFilePath
-                          << "\n";
-                return;
-            }
-            newFile.close();
-        }
-        fileCheck.close();
-        // Now, the file is guaranteed to exist. Open it and write.
-        std::ofstream sstFile(newFilePath,
-                              std::ios::app);  // Open the file in append mode.
+        // 先写入临时文件，写完后rename成sst，崩溃时不会留下写了一半的sst
+        std::string tmpFilePath = newFilePath + SS_TMP_FILE_SUFFIX;
+        std::ofstream sstFile(tmpFilePath, std::ios::binary | std::ios::trunc);
         if (!sstFile) {
-            std::cerr << "Failed to open the file: " << newFilePath << "\n";
+            std::cerr << "Failed to open the file: " << tmpFilePath << "\n";
             return;
         }
         sstFile.write(reinterpret_cast<const char *>(&(curP->timeStamp)),
@@ -803,50 +1076,148 @@ void KVStore::writeSSTToDisk(FILE_NUM_TL level,
                       sizeof(curP->minKey));
         sstFile.write(reinterpret_cast<const char *>(&(curP->maxKey)),
                       sizeof(curP->maxKey));
-        // write bloom filter to SST
-        char buffer = 0;
-        for (int i = 0; i < DEFAULT_M_VAL; i++) {
-            buffer = (buffer << 1) | (curP->bf).bitArray[i];
-            if ((i + 1) % 8 == 0) {
-                sstFile.write(reinterpret_cast<const char *>(&buffer),
-                              sizeof(buffer));
-                buffer = 0;
-            }
-        }
-
+        // header之后依次是data block、index block、filter与footer
+        std::string body;
+        std::vector<sstblock::IndexEntry> index;
+        // 各data block首个entry的下标，随hash index写入
+        std::vector<uint32_t> blockStarts;
+        sstblock::BlockBuilder builder;
+        auto finishBlock = [&]() {
+            KEY_TL lastKey = builder.getLastKey();
+            std::string block = builder.finish();
+            index.push_back({lastKey, uint32_t(SS_HEADER_BYTENUM + body.size()),
+                             uint32_t(block.size())});
+            body += block;
+        };
         for (SST_HEADER_KVNUM_TL i = 0; i < curP->kvNum; i++) {
-            writeSSTEntry(sstFile, curP->keyList[i], curP->offsetList[i],
-                          curP->vlenList[i]);
+            if (!builder.empty() && builder.bytesAfterAdd() > SS_BLOCK_BYTENUM)
+                finishBlock();
+            if (builder.empty()) blockStarts.push_back(i);
+            builder.add(curP->keyList[i], curP->offsetList[i],
+                        curP->vlenList[i]);
         }
+        if (!builder.empty()) finishBlock();
+        sstblock::Footer footer;
+        // 重新打开时据此确定vlog的重放起点，不必解码entry
+        footer.vlogEnd = 0;
+        for (SST_HEADER_KVNUM_TL i = 0; i < curP->kvNum; i++)
+            footer.vlogEnd =
+                std::max(footer.vlogEnd, curP->offsetList[i] +
+                                             VLOG_ENTRY_HEADER_BYTENUM +
+                                             curP->vlenList[i]);
+        footer.indexOffset = SS_HEADER_BYTENUM + body.size();
+        sstblock::putFixed32(body, uint32_t(index.size()));
+        for (auto &entry : index) {
+            sstblock::putFixed64(body, entry.lastKey);
+            sstblock::putFixed32(body, entry.offset);
+            sstblock::putFixed32(body, entry.bytes);
+        }
+        if (!curP->learnedIndex.empty()) curP->learnedIndex.appendTo(body);
+        if (!curP->hashIndex.empty())
+            curP->hashIndex.appendTo(body, blockStarts);
+        footer.filterOffset = SS_HEADER_BYTENUM + body.size();
+        footer.version = SS_FORMAT_VERSION;
+        footer.magic = SS_FOOTER_MAGIC;
+        sstFile.write(body.data(), body.size());
+        // write filter to SST
+        curP->filter.writeTo(sstFile);
+        curP->rangeFilter.writeTo(sstFile);
+        sstFile.write(reinterpret_cast<const char *>(&footer),
+                      SS_FOOTER_BYTENUM);
         sstFile.close();
+        if (!sstFile || std::rename(tmpFilePath.c_str(), newFilePath.c_str())) {
+            std::cerr << "Failed to write the file: " << newFilePath << "\n";
+            return;
+        }
     }
 }
-void KVStore::writeSSTToCache(FILE_NUM_TL level,
-                              std::vector<sstInfoItemProps> &list) {
+// installSST - 调用者需持有levelMutex的独占锁(构造期间没有其他线程)
+void KVStore::installSST(FILE_NUM_TL level, SSTMetaProps meta) {
     if ((long)levelCache.size() - 1 < (long)level) levelCache.resize(level + 1);
-    for (auto &item : list) {
-        auto emplaceResult = levelCache[level].emplace(
-            std::piecewise_construct, std::forward_as_tuple(item.minKey),
-            std::forward_as_tuple(item));
-        hashCachePtrByUid[item.uid] = &((*emplaceResult).second);
+    KEY_TL minKey = meta.minKey;
+    levelCache[level].emplace(minKey, std::move(meta));
+}
+// makeSSTMeta - 打开sst的映射，filter移入返回的元数据，entry数组放入tableCache;
+// 不访问levelCache，不需持有levelMutex
+KVStore::SSTMetaProps KVStore::makeSSTMeta(FILE_NUM_TL level,
+                                           sstInfoItemProps &item) {
+    auto reader = std::make_shared<SSTReader>();
+    if (!reader->open(sstFilePath(level, item.uid))) {
+        std::cerr << "Failed to open file: " << sstFilePath(level, item.uid)
+                  << std::endl;
+        reader.reset();
     }
+    SSTMetaProps meta{item.uid,
+                      item.timeStamp,
+                      item.kvNum,
+                      item.minKey,
+                      item.maxKey,
+                      std::move(item.filter),
+                      std::move(item.rangeFilter),
+                      std::move(reader)};
+    item.filter = SSTFilter();
+    item.rangeFilter = RangeFilter();
+    insertTableCache(std::make_shared<sstInfoItemProps>(item));
+    return meta;
 }
-void KVStore::writeKOVListToDiskAndCache(std::list<KEY_TL> &keyList,
-                                         std::vector<SS_OFFSET_TL> &offsetList,
-                                         std::vector<SS_VLEN_TL> &vlenList,
-                                         FILE_NUM_TL sonLevel,
-                                         SS_TIMESTAMP_TL maxTimeStampToWrite) {
-    // 扩充过短的vector
-    if ((long)levelCache.size() - 1 < (long)sonLevel)
-        levelCache.resize(sonLevel + 1);
-
-    std::vector<sstInfoItemProps> SSTList;
-    generateSSTList(keyList, offsetList, vlenList, SSTList,
-                    maxTimeStampToWrite);
-    writeSSTToDisk(sonLevel, SSTList);
-    writeSSTToCache(sonLevel, SSTList);
+// insertTableCache - 按keyLayout建查找结构; SUCCINCT时只缓存压缩表示
+void KVStore::insertTableCache(std::shared_ptr<sstInfoItemProps> item) {
+    FILE_NUM_TL uid = item->uid;
+    auto cached = std::make_shared<CachedSST>();
+    if (options.keyLayout == KeyLayout::SUCCINCT) {
+        cached->succinct =
+            SuccinctEntries(item->keyList.data(), item->offsetList.data(),
+                            item->vlenList.data(), item->kvNum);
+    } else {
+        // 有hash index的sst点查不经过Eytzinger，不必再建
+        item->buildKeyLayout(item->hashIndex.empty() ? options.keyLayout
+                                                     : KeyLayout::SORTED);
+        cached->plain = std::move(item);
+    }
+    tableCache.insert(uid, cached, cached->charge());
+}
+std::string KVStore::sstFilePath(FILE_NUM_TL level, FILE_NUM_TL uid) {
+    return dir + SS_DIR_PATH_SUFFIX_WITHOUT_LEVELNUM + std::to_string(level) +
+           "/" + std::to_string(uid) + SS_FILE_SUFFIX;
+}
+// loadSST - 取sst的entry数组，不在tableCache中时从文件读入
+// fillCache为false时读入的数组不放入tableCache，用于即将被删除的sst
+std::shared_ptr<const KVStore::sstInfoItemProps> KVStore::loadSST(
+    FILE_NUM_TL level, const SSTMetaProps &meta, bool fillCache) {
+    std::shared_ptr<const CachedSST> cached = tableCache.lookup(meta.uid);
+    if (cached && cached->plain) return cached->plain;
+    if (cached) {
+        // 压缩表示需解压成完整数组，供scan与合并按下标访问
+        auto item = std::make_shared<sstInfoItemProps>();
+        item->uid = meta.uid, item->timeStamp = meta.timeStamp;
+        item->minKey = meta.minKey, item->maxKey = meta.maxKey;
+        item->resizeEntries(cached->succinct.size());
+        cached->succinct.decode(item->keyList.data(), item->offsetList.data(),
+                                item->vlenList.data());
+        return item;
+    }
+    auto fileItem = std::make_shared<sstInfoItemProps>();
+    // 元数据中的映射只在makeSSTMeta时打开失败才为空，此时再试一次
+    std::shared_ptr<const SSTReader> reader = meta.reader;
+    if (!reader) {
+        std::string filePath = sstFilePath(level, meta.uid);
+        auto opened = std::make_shared<SSTReader>();
+        if (opened->open(filePath))
+            reader = opened;
+        else
+            std::cerr << "Failed to open file: " << filePath << std::endl;
+    }
+    if (reader)
+        fillFileItemFromSST(*reader, *fileItem);
+    else
+        fileItem->resizeEntries(0);
+    fileItem->uid = meta.uid;
+    if (fillCache) insertTableCache(fileItem);
+    return fileItem;
 }
 void KVStore::examineOld() {
+    // 已flush进sst的vlog entry的最大结束位置，其后的entry只存在于崩溃前的memTable
+    SS_OFFSET_TL flushedEnd = 0;
     std::vector<std::string> nameList;
     int fileNum = utils::scanDir(dir, nameList);
     for (int i = 0; i < fileNum; i++) {
@@ -864,48 +1235,79 @@ void KVStore::examineOld() {
             std::vector<std::string> fileNameList;
             int secondFileNum = utils::scanDir(dirPath, fileNameList);
             for (int j = 0; j < secondFileNum; j++) {
-                std::string curFilePath = dirPath + "/" + fileNameList[j];
-                sstInfoItemProps fileItem;
-                readFileNGetFileItem(curFilePath, fileItem);
-                std::string::size_type suffix_pos =
-                    fileNameList[j].rfind(SS_FILE_SUFFIX);
-                if (suffix_pos != std::string::npos) {
-                    std::string numStr = fileNameList[j].substr(0, suffix_pos);
-                    FILE_NUM_TL num =
-                        static_cast<FILE_NUM_TL>(std::stoi(numStr));
-                    largestUid = std::max(largestUid, num);
-                    fileItem.uid = num;
+                const std::string &fileName = fileNameList[j];
+                std::string curFilePath = dirPath + "/" + fileName;
+                // 写入中途崩溃留下的临时文件，对应的sst从未生效
+                if (utils::endsWith(fileName, SS_TMP_FILE_SUFFIX)) {
+                    utils::rmfile(curFilePath);
+                    continue;
                 }
-
-                largestTimeStamp =
-                    std::max(largestTimeStamp, fileItem.timeStamp);
-                if ((long)levelCache.size() - 1 < (long)curLevel)
-                    levelCache.resize(curLevel + 1);
-                auto insertResult = levelCache[curLevel].insert(
-                    std::make_pair(fileItem.minKey, fileItem));
-                hashCachePtrByUid[fileItem.uid] = &insertResult->second;
+                if (!utils::endsWith(fileName, SS_FILE_SUFFIX)) continue;
+                std::string numStr = fileName.substr(
+                    0, fileName.size() - std::strlen(SS_FILE_SUFFIX));
+                FILE_NUM_TL num = static_cast<FILE_NUM_TL>(std::stoull(numStr));
+                // 无法识别的sst不能跳过: 其中的key会读到更旧的版本，
+                // 据offset推算的vlog重放起点也不可信，只能拒绝打开
+                SSTMetaProps meta;
+                SS_OFFSET_TL vlogEnd;
+                if (!readSSTMeta(curFilePath, num, meta, vlogEnd))
+                    throw std::runtime_error("unsupported or corrupt sst: " +
+                                             curFilePath);
+                largestUid = std::max(largestUid, num);
+                flushedEnd = std::max(flushedEnd, vlogEnd);
+                largestTimeStamp = std::max(largestTimeStamp, meta.timeStamp);
+                installSST(curLevel, std::move(meta));
             }
-        } else {
-            // it is a file.
-            // examine Vlog To Head And Tail
-            std::ifstream vlogFile(dirPath, std::ifstream::binary);
-            if (!vlogFile.is_open()) {
-                // handle error
-            }
-            head = vlogFile.tellg();
-            SS_OFFSET_TL afterHoleOffset =
-                utils::seek_data_block(dirPath.c_str());
-            SS_OFFSET_TL tailCandidate = afterHoleOffset;
-            moveToFirstMagicPos(vlogFile, tailCandidate);
-            if (tailCandidate == head) return;
-            // tailCandidate
-            while (!checkTailCandidateValidity(tailCandidate)) {
-                moveToFirstMagicPos(vlogFile, ++tailCandidate);
-                if (tailCandidate == head) return;
-            }
-            tail = tailCandidate;
         }
     }
+    // 写入时是最深一层、现在已不是的sst没有filter
+    fillMissingFilters();
+    // examine Vlog To Head And Tail
+    std::ifstream vlogFile(vlog, std::ifstream::binary | std::ifstream::ate);
+    if (!vlogFile.is_open()) return;
+    head = vlogFile.tellg();
+    examineVlogTail(vlogFile);
+    vlogFile.close();
+    replayVlog(std::max(tail, flushedEnd));
+}
+void KVStore::examineVlogTail(std::ifstream &vlogFile) {
+    off_t afterHoleOffset = utils::seek_data_block(vlog.c_str());
+    if (afterHoleOffset < 0 || (SS_OFFSET_TL)afterHoleOffset >= head) {
+        // 空文件或全部已被打洞
+        tail = head;
+        return;
+    }
+    SS_OFFSET_TL tailCandidate = afterHoleOffset;
+    moveToFirstMagicPos(vlogFile, tailCandidate);
+    // tailCandidate
+    while (tailCandidate != head &&
+           !checkTailCandidateValidity(tailCandidate)) {
+        moveToFirstMagicPos(vlogFile, ++tailCandidate);
+    }
+    tail = tailCandidate;
+}
+// replayVlog - 将offset之后的有效entry重新插入memTable
+void KVStore::replayVlog(SS_OFFSET_TL offset) {
+    std::ifstream vlogFile(vlog, std::ios::binary);
+    while (offset < head && checkTailCandidateValidity(offset)) {
+        KEY_TL key;
+        SS_VLEN_TL vlen;
+        SS_OFFSET_TL offsetRecord =
+            offset + VLOG_MAGIC_BYTENUM + VLOG_CHECKSUM_BYTENUM;
+        readDataFromVlog(vlogFile, key, offsetRecord);
+        readDataFromVlog(vlogFile, vlen, offsetRecord + SS_KEY_BYTENUM);
+        if (memTableFull()) {
+            convertAndWriteMemTable(memTable);
+            clearMemTable();
+        }
+        memTable->put(key, VlogPointer{offset, vlen});
+        offset += VLOG_ENTRY_HEADER_BYTENUM + vlen;
+    }
+    if (offset < head) {
+        // 崩溃时写了一半的entry，截掉
+        if (truncate(vlog.c_str(), offset)) perror("truncate");
+        head = offset;
+    }
 }
 
 /**
@@ -913,93 +1315,107 @@ void KVStore::examineOld() {
  * keys in the list should be in an ascending order.
  * An empty list indicates not found.
  */
+// scan - 多路归并memTable/immMemTable与区间内可能有key的sst
+// 同一key以最新的来源为准: memTable > immMemTable > 层号小 > 同层timestamp大，
+// 与get的查找顺序一致; 已删除的key不返回
 void KVStore::scan(uint64_t key1, uint64_t key2,
                    std::list<std::pair<uint64_t, std::string>> &list) {
     list.clear();
-    if (OPTION_1) {
-        const std::vector<SS_OFFSET_TL> tmpOffsetVtr;
-        const std::vector<SS_VLEN_TL> tmpVlenVtr;
-        const std::list<KEY_TL> tmpMemtableList;
-        // memtable 指针
-        std::list<std::pair<uint64_t, std::string>> memtableList;
-        memTable->scanRange(key1, key2, memtableList);
-        if (!memtableList.empty()) {
-            std::vector<sstInfoItemProps> memtableVector;
-            memtableVector.emplace_back(sstInfoItemProps(
-                0, 0, memtableList.size(), key1, key2, tmpMemtableList.begin(),
-                tmpOffsetVtr.begin(), tmpVlenVtr.begin()));
-            ptrTracks.emplace_back(PtrTrackProps(memtableVector));
-        }
-
-        // Level 0 指针
-        for (const auto &entry : levelCache[0]) {
-            if (entry.second.maxKey >= key1 && entry.second.minKey <= key2) {
-                ptrTracks.emplace_back(PtrTrackProps({entry.second}));
+    if (key1 > key2) return;
+    // ScanCursor - 一个来源中落在区间内的有序entry，rank越小越新
+    struct ScanCursor {
+        const KEY_TL *keys;
+        const SS_OFFSET_TL *offsets;
+        const SS_VLEN_TL *vlens;
+        size_t pos, end, rank;
+    };
+    std::vector<ScanCursor> cursors;
+    std::vector<std::shared_ptr<const sstInfoItemProps>> tables;
+    // 归并读完全部value之前，gc不能在已取出的offset处打洞
+    std::shared_lock<std::shared_mutex> readLock(vlogReadMutex);
+    // memTable中的entry先拷出，不在持有memMutex时查sst
+    std::vector<KEY_TL> memKeys[2];
+    std::vector<SS_OFFSET_TL> memOffsets[2];
+    std::vector<SS_VLEN_TL> memVlens[2];
+    {
+        std::shared_lock<std::shared_mutex> lock(memMutex);
+        memtable_type *tables[2] = {memTable, immMemTable};
+        for (int t = 0; t < 2; t++) {
+            if (!tables[t]) continue;
+            std::list<std::pair<uint64_t, VlogPointer>> entries;
+            tables[t]->scan(key1, key2, entries);
+            for (auto &entry : entries) {
+                memKeys[t].push_back(entry.first);
+                memOffsets[t].push_back(entry.second.offset);
+                memVlens[t].push_back(entry.second.vlen);
             }
         }
+    }
+    for (int t = 0; t < 2; t++)
+        if (!memKeys[t].empty())
+            cursors.push_back({memKeys[t].data(), memOffsets[t].data(),
+                               memVlens[t].data(), 0, memKeys[t].size(),
+                               size_t(t)});
 
-        // 其他层指针
-        for (FILE_NUM_TL level = 1; level < levelCache.size(); ++level) {
-            std::vector<sstInfoItemProps> trackFiles;
-            for (const auto &entry : levelCache[level]) {
-                if (entry.second.maxKey >= key1 &&
-                    entry.second.minKey <= key2) {
-                    trackFiles.push_back(entry.second);
-                }
-            }
-            if (!trackFiles.empty()) {
-                ptrTracks.emplace_back(PtrTrackProps(trackFiles));
-            }
+    std::shared_lock<std::shared_mutex> levelLock(levelMutex);
+    for (FILE_NUM_TL level = 0; level < levelCache.size(); level++) {
+        std::vector<const SSTMetaProps *> files;
+        // levelCache按minKey有序，minKey > key2的sst不必再看
+        auto last = levelCache[level].upper_bound(key2);
+        for (auto it = levelCache[level].begin(); it != last; ++it) {
+            const SSTMetaProps &item = it->second;
+            if (item.maxKey < key1) continue;
+            if (!item.rangeFilter.mayContain(std::max<KEY_TL>(key1, item.minKey),
+                                             std::min<KEY_TL>(key2, item.maxKey)))
+                continue;
+            files.push_back(&item);
         }
-
-        // 多路归并
-        std::priority_queue<TrackPointerProps, std::vector<TrackPointerProps>,
-                            CompareForPointerQueue>
-            pointerQueue;
-        for (size_t i = 0; i < ptrTracks.size(); ++i) {
-            if (!ptrTracks[i].fileInfoList.empty()) {
-                pointerQueue.emplace(TrackPointerProps(0, 0, i));
-            }
+        std::sort(files.begin(), files.end(),
+                  [](const SSTMetaProps *a, const SSTMetaProps *b) {
+                      return a->timeStamp > b->timeStamp;
+                  });
+        for (const SSTMetaProps *meta : files) {
+            // 归并结束前持有entry数组，期间被tableCache淘汰也不失效
+            const sstInfoItemProps *item =
+                tables.emplace_back(loadSST(level, *meta)).get();
+            const KEY_TL *keys = item->keyList.data();
+            size_t begin =
+                std::lower_bound(keys, keys + item->kvNum, key1) - keys;
+            size_t end =
+                std::upper_bound(keys + begin, keys + item->kvNum, key2) - keys;
+            if (begin < end)
+                cursors.push_back({keys, item->offsetList.data(),
+                                   item->vlenList.data(), begin, end,
+                                   cursors.size() + 2});
         }
+    }
 
-        while (!pointerQueue.empty()) {
-            TrackPointerProps topPointer = pointerQueue.top();
-            pointerQueue.pop();
-
-            const sstInfoItemProps *topFilePtr =
-                &ptrTracks[topPointer.trackIndex]
-                     .fileInfoList[topPointer.fileIndex];
-            size_t topEntryIndex = topPointer.CacheItemIndex;
-
-            KEY_TL topKey = topFilePtr->keyList[topEntryIndex];
-            if (topKey >= key1 && topKey <= key2) {
-                SS_VLEN_TL vlen = topFilePtr->vlenList[topEntryIndex];
-                if (vlen > 0) {
-                    std::string value;
-                    std::ifstream vlogFile(vlog, std::ios::binary);
-                    readValStringFromVlog(vlogFile, value,
-                                          topFilePtr->offsetList[topEntryIndex],
-                                          vlen);
-                    list.emplace_back(topKey, value);
-                } else {
-                    list.emplace_back(topKey, DELETE_MARK);
-                }
-            }
-
-            // 更新指针
-            topPointer.CacheItemIndex++;
-            if (topPointer.CacheItemIndex == topFilePtr->kvNum) {
-                topPointer.CacheItemIndex = 0;
-                topPointer.fileIndex++;
-            }
-            if (topPointer.fileIndex <
-                ptrTracks[topPointer.trackIndex].fileInfoList.size()) {
-                pointerQueue.push(topPointer);
+    // 败者树: key小的先出，key相同时rank小(较新)的先出，故seq取~rank
+    LoserTree tree(cursors.size());
+    for (size_t i = 0; i < cursors.size(); i++) {
+        const ScanCursor &cur = cursors[i];
+        tree.set(i, cur.keys[cur.pos], ~uint64_t(cur.rank));
+    }
+    tree.build();
+    bool emitted = false;
+    KEY_TL lastKey = 0;
+    while (!tree.empty()) {
+        ScanCursor &cur = cursors[tree.top()];
+        KEY_TL key = cur.keys[cur.pos];
+        if (!emitted || key != lastKey) {
+            emitted = true, lastKey = key;
+            if (cur.vlens[cur.pos]) {
+                // 读失败(已在getValueByOffsetnVlen中报错)的entry不返回，
+                // 不能当作空value
+                std::string value = getValueByOffsetnVlen(cur.offsets[cur.pos],
+                                                          cur.vlens[cur.pos]);
+                if (!value.empty()) list.emplace_back(key, std::move(value));
             }
         }
-    } else {
-        for (KEY_TL i = key1; i <= key2; i++)
-            list.push_back(std::make_pair(i, get(i)));
+        if (++cur.pos < cur.end)
+            tree.replaceTop(cur.keys[cur.pos], ~uint64_t(cur.rank));
+        else
+            tree.popTop();
     }
 }
 
@@ -1012,34 +1428,41 @@ void KVStore::printSST(SST_LEVEL_TL level, FILE_NUM_TL uid) {
     ss << dir << "/" << SS_DIR_PATH_SUFFIX_WITHOUT_LEVELNUM << level << "/"
        << uid << SS_FILE_SUFFIX;
     std::string filePath = ss.str();
-    std::ifstream file(filePath, std::ios::binary);
-    if (!file) {
+    SSTReader reader;
+    if (!reader.open(filePath)) {
         std::cerr << "Failed to open file: " << filePath << std::endl;
         return;
     }
-    SSTHeaderProps headerProps;
-    readHeaderPropsFromSST(file, headerProps);
-    std::cout << "timestamp: " << headerProps.timestamp
-              << ",kvNum: " << headerProps.kvNum
-              << ",minKey: " << headerProps.minKey
-              << ",maxKey: " << headerProps.maxKey << std::endl;
+    std::cout << "timestamp: " << reader.timeStamp
+              << ",kvNum: " << reader.kvNum << ",minKey: " << reader.minKey
+              << ",maxKey: " << reader.maxKey << std::endl;
     std::cout << "entries: \n";
-    for (SST_HEADER_KVNUM_TL i = 0; i < headerProps.kvNum; i++) {
-        SSTEntryProps entry;
-        readEntryFromSST(file, entry, i);
-        std::cout << "[" << i << ": " << entry.key << ", " << entry.offset
-                  << ", " << entry.vlen << "]";
+    sstInfoItemProps fileItem;
+    fillFileItemFromSST(reader, fileItem);
+    for (SST_HEADER_KVNUM_TL i = 0; i < fileItem.kvNum; i++) {
+        std::cout << "[" << i << ": " << fileItem.keyList[i] << ", "
+                  << fileItem.offsetList[i] << ", " << fileItem.vlenList[i]
+                  << "]";
     }
     std::cout << std::endl;
     std::cout << "----END printSST----\n";
 }
 
 void KVStore::printSSTCache(SST_LEVEL_TL level, FILE_NUM_TL uid) {
-    sstInfoItemProps *sstInfoItemPtr = hashCachePtrByUid[uid];
-    if (sstInfoItemPtr == nullptr) {
-        std::cerr << "ERR: CacheItemPtr==nullptr\n";
+    std::shared_ptr<const CachedSST> cached = tableCache.lookup(uid);
+    if (cached == nullptr) {
+        std::cerr << "ERR: sst " << uid << " not in tableCache\n";
         return;
     }
+    std::shared_ptr<const sstInfoItemProps> sstInfoItemPtr = cached->plain;
+    if (!sstInfoItemPtr) {
+        auto item = std::make_shared<sstInfoItemProps>();
+        item->uid = uid;
+        item->resizeEntries(cached->succinct.size());
+        cached->succinct.decode(item->keyList.data(), item->offsetList.data(),
+                                item->vlenList.data());
+        sstInfoItemPtr = item;
+    }
     std::cout << "----printCache----\n";
 
     std::cout << ",kvNum: " << sstInfoItemPtr->kvNum;
@@ -1053,13 +1476,14 @@ void KVStore::printSSTCache(SST_LEVEL_TL level, FILE_NUM_TL uid) {
     std::cout << "----END printCache----\n";
 }
 
-bool KVStore::checkTailCandidateValidity(int candidate) {
+bool KVStore::checkTailCandidateValidity(SS_OFFSET_TL candidate) {
     SS_OFFSET_TL offsetRecord = candidate;
+    if (candidate + VLOG_ENTRY_HEADER_BYTENUM > head) return false;
     std::ifstream vlogFile(vlog, std::ios::binary);
     VLOG_MAGIC_TL curMagic;
     readDataFromVlog(vlogFile, curMagic, offsetRecord);
     offsetRecord += VLOG_MAGIC_BYTENUM;
-    if (curMagic != VLOG_DEFAULT_MAGIC_VAL) return false;
+    if (!IS_VLOG_MAGIC(curMagic)) return false;
 
     VLOG_CHECKSUM_TL curChecksum;
     readDataFromVlog(vlogFile, curChecksum, offsetRecord);
@@ -1070,6 +1494,7 @@ bool KVStore::checkTailCandidateValidity(int candidate) {
     SS_VLEN_TL curVlen;
     readDataFromVlog(vlogFile, curVlen, offsetRecord);
     offsetRecord += SS_VLEN_BYTENUM;
+    if (offsetRecord + curVlen > head) return false;
     std::string curValue;
     readValStringFromVlog(vlogFile, curValue, offsetRecord, curVlen);
     offsetRecord += curVlen;
@@ -1080,41 +1505,102 @@ bool KVStore::checkTailCandidateValidity(int candidate) {
     return true;
 }
 
-void KVStore::generateSSTList(const std::list<KEY_TL> &keyList,
-                              const std::vector<SS_OFFSET_TL> &offsetList,
-                              const std::vector<SS_VLEN_TL> &vlenList,
-                              std::vector<sstInfoItemProps> &userSSTList,
-                              SS_TIMESTAMP_TL timestampToWrite) {
-    SST_HEADER_KVNUM_TL totalKVNum = keyList.size();
-    // 计算时向上取整
-    FILE_NUM_TL totalSSTNum =
-        (totalKVNum + MAX_SST_KV_GROUP_NUM - 1) / MAX_SST_KV_GROUP_NUM;
-    for (FILE_NUM_TL i = 0; i < totalSSTNum; i++) {
-        SST_HEADER_KVNUM_TL headKVIndex = MAX_SST_KV_GROUP_NUM * i,
-                            tailKVIndex = MAX_SST_KV_GROUP_NUM * i +
-                                          MAX_SST_KV_GROUP_NUM - 1;
-        if (tailKVIndex > totalKVNum - 1) tailKVIndex = totalKVNum - 1;
-        auto tmpIter = keyList.begin();
-        std::advance(tmpIter, headKVIndex);
-        for (SST_HEADER_KVNUM_TL ind = headKVIndex; ind <= tailKVIndex; ind++) {
-            // #ifdef WATCH
-            if (WATCHED_KEY && *tmpIter == WATCHED_KEY) {
-                std::cout << "WATCHED_KEY in sstuid: " << largestUid + 1
-                          << " offset: " << offsetList[ind]
-                          << " timestamp: " << timestampToWrite << " \n";
+bool KVStore::hashIndexAt(FILE_NUM_TL level) {
+    return level < 64 && (options.hashIndexLevels >> level & 1);
+}
+// filterBitsPerKey - 写入level层的sst应分配的bits/key，0表示不建filter
+double KVStore::filterBitsPerKey(FILE_NUM_TL level) {
+    FILE_NUM_TL levelNum = std::max<FILE_NUM_TL>(levelCache.size(), level + 1);
+    if (!options.lastLevelFilter && level && level + 1 == levelNum) return 0;
+    if (options.filterAllocation == FilterAllocation::UNIFORM)
+        return options.bloomBitsPerKey;
+    // 第0层的sst区间互相重叠，每个sst各算一个run;
+    // 第1层起每层整体是一个run，按该层满载时的entry数计;
+    // 最深一层不建filter时不参与分配，预算只在其上各run之间分
+    std::vector<double> runEntries(maxFileNum(0), sstEntryNum);
+    FILE_NUM_TL filteredLevelNum =
+        !options.lastLevelFilter && levelNum > 1 ? levelNum - 1 : levelNum;
+    for (FILE_NUM_TL l = 1; l < filteredLevelNum; l++)
+        runEntries.push_back(double(maxFileNum(l)) * sstEntryNum);
+    std::vector<double> bits =
+        monkeyBitsPerKey(runEntries, options.bloomBitsPerKey);
+    return level ? bits[maxFileNum(0) + level - 1] : bits[0];
+}
+// fillMissingFilters - 由levelCache的唯一修改者调用，不需持有levelMutex
+// 最深一层在lastLevelFilter为false时不建filter; 其下出现新层后，这些sst
+// 不再是最深一层，由keyList补建filter。补建的filter只在内存中，重新打开时再建
+// 读sst、建filter只持共享锁，独占锁下只把建好的filter放入元数据
+void KVStore::fillMissingFilters() {
+    std::vector<std::pair<SSTMetaProps *, SSTFilter>> filters;
+    {
+        std::shared_lock<std::shared_mutex> levelLock(levelMutex);
+        for (FILE_NUM_TL level = 0; level + 1 < levelCache.size(); level++) {
+            double bitsPerKey = filterBitsPerKey(level);
+            if (bitsPerKey <= 0) continue;
+            for (auto &item : levelCache[level]) {
+                SSTMetaProps &meta = item.second;
+                if (meta.filter.type() != FilterType::NONE || !meta.kvNum)
+                    continue;
+                std::shared_ptr<const sstInfoItemProps> table =
+                    loadSST(level, meta, false);
+                filters.emplace_back(
+                    &meta, SSTFilter::build(options.filterType,
+                                            table->keyList.data(),
+                                            table->kvNum, bitsPerKey));
             }
-            // #endif
-            std::advance(tmpIter, 1);
         }
-        auto minIter = keyList.begin();
-        std::advance(minIter, headKVIndex);
-        auto maxIter = minIter;
-        std::advance(maxIter, tailKVIndex - headKVIndex + 1);
-        userSSTList.emplace_back(
-            ++largestUid, timestampToWrite, tailKVIndex - headKVIndex + 1,
-            *std::min_element(minIter, maxIter),
-            *std::max_element(minIter, maxIter), minIter,
-            offsetList.begin() + headKVIndex, vlenList.begin() + headKVIndex);
+    }
+    if (filters.empty()) return;
+    std::unique_lock<std::shared_mutex> levelLock(levelMutex);
+    for (auto &[meta, filter] : filters) meta->filter = std::move(filter);
+}
+// maxFileNum - 第level层最多的sst数，超出时向下一层合并
+FILE_NUM_TL KVStore::maxFileNum(FILE_NUM_TL level) {
+    FILE_NUM_TL num = std::max<uint32_t>(1, options.level0FileNum);
+    for (FILE_NUM_TL l = 0; l < level; l++)
+        num *= std::max<uint32_t>(1, options.levelSizeRatio);
+    return num;
+}
+
+// generateSSTListFromMemTable - 每sstEntryNum个entry切分出一个sst
+void KVStore::generateSSTListFromMemTable(
+    memtable_type *table, std::vector<sstInfoItemProps> &userSSTList,
+    SS_TIMESTAMP_TL timestampToWrite) {
+    // 预留足够空间，填充过程中已有元素不会被搬移
+    userSSTList.reserve((table->getLength() + sstEntryNum - 1) / sstEntryNum);
+    sstInfoItemProps *cur = nullptr;
+    for (auto iter = table->newIterator(); iter->valid(); iter->next()) {
+        KEY_TL key = iter->key();
+        VlogPointer ptr = iter->value();
+        if (!cur || cur->kvNum == sstEntryNum) {
+            cur = &userSSTList.emplace_back();
+            cur->uid = ++largestUid;
+            cur->timeStamp = timestampToWrite;
+            cur->kvNum = 0;
+            cur->minKey = key;
+            size_t entryNum =
+                std::min<size_t>(sstEntryNum, table->getLength());
+            cur->keyList.reserve(entryNum);
+            cur->offsetList.reserve(entryNum);
+            cur->vlenList.reserve(entryNum);
+        }
+        if (WATCHED_KEY && key == WATCHED_KEY) {
+            std::cout << "WATCHED_KEY in sstuid: " << cur->uid
+                      << " offset: " << ptr.offset
+                      << " timestamp: " << timestampToWrite << " \n";
+        }
+        cur->keyList.push_back(key);
+        cur->offsetList.push_back(ptr.offset);
+        cur->vlenList.push_back(ptr.vlen);
+        cur->maxKey = key;
+        cur->kvNum++;
+    }
+    double bitsPerKey = filterBitsPerKey(0);
+    for (auto &item : userSSTList) {
+        item.buildFilter(options.filterType, bitsPerKey);
+        item.buildRangeFilter(options.rangeBitsPerKey);
+        item.buildLearnedIndex(options.learnedIndex);
+        item.buildHashIndex(hashIndexAt(0));
     }
 }
 
@@ -1123,17 +1609,18 @@ void KVStore::printUidContainsWatchedKey() {
         auto &level = levelCache[i];
         for (auto itemIter = level.begin(); itemIter != level.end();
              ++itemIter) {
-            auto &item = *itemIter;
-            for (SST_HEADER_KVNUM_TL ii = 0; ii < item.second.kvNum; ii++)
-                if (item.second.keyList[ii] == WATCHED_GC_KEY) {
-                    std::cout << "SNAPSHOT: key in " << item.second.uid
+            std::shared_ptr<const sstInfoItemProps> item =
+                loadSST(i, itemIter->second, false);
+            for (SST_HEADER_KVNUM_TL ii = 0; ii < item->kvNum; ii++)
+                if (item->keyList[ii] == WATCHED_GC_KEY) {
+                    std::cout << "SNAPSHOT: key in " << item->uid
                               << " at level: " << i << "\n";
-                    for (SST_HEADER_KVNUM_TL zz = 0; zz < item.second.kvNum;
+                    for (SST_HEADER_KVNUM_TL zz = 0; zz < item->kvNum;
                          zz++) {
-                        if (item.second.keyList[zz] == WATCHED_GC_KEY) {
-                            std::cout << "[" << item.second.keyList[zz] << ", "
-                                      << item.second.offsetList[zz] << ", "
-                                      << item.second.vlenList[zz] << "]";
+                        if (item->keyList[zz] == WATCHED_GC_KEY) {
+                            std::cout << "[" << item->keyList[zz] << ", "
+                                      << item->offsetList[zz] << ", "
+                                      << item->vlenList[zz] << "]";
                         }
                     }
                 }
@@ -1143,7 +1630,8 @@ void KVStore::printUidContainsWatchedKey() {
 void KVStore::lookInMemtable(KEY_TL key) {
     auto res = memTable->get(key);
     if (res.has_value())
-        std::cout << "spot in memtable: " << res.value() << "\n";
+        std::cout << "spot in memtable: [" << res->offset << ", " << res->vlen
+                  << "]\n";
     else
         std::cout << "NOT spot in memtable\n";
 }
@@ -2,19 +2,34 @@
 
 #include <algorithm>
 #include <cassert>
+#include <condition_variable>
 #include <fstream>
 #include <limits>
 #include <map>
-#include <queue>
 #include <set>
+#include <shared_mutex>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
-#include "bloomfilter.h"
+#include "arena_skiplist.h"
+#include "btree_memtable.h"
+#include "eytzinger.h"
+#include "filter.h"
+#include "hashindex.h"
 #include "kvstore_api.h"
-#include "skiplist.h"
+#include "learnedindex.h"
+#include "losertree.h"
+#include "options.h"
+#include "rangefilter.h"
+#include "sstblock.h"
+#include "sstreader.h"
+#include "succinct.h"
+#include "tablecache.h"
 #include "type.h"
 #include "utils.h"
+#include "vector_memtable.h"
+#include "vlogcodec.h"
 using namespace skiplist;
 
 class KVStore : public KVStoreAPI {
@@ -24,17 +39,54 @@ class KVStore : public KVStoreAPI {
     // for vlog
     SS_OFFSET_TL head;
     SS_OFFSET_TL tail;
+    int vlogFd = -1;      // 追加写，由vlogMutex串行化
+    int vlogReadFd = -1;  // pread读value，可并发
+    std::mutex vlogMutex;
+    // vlogReadMutex使读value与gc打洞、reset互斥: get/scan从查找offset到读完value
+    // 持共享锁，打洞与reset持独占锁; gc须先释放memMutex再获取它
+    std::shared_mutex vlogReadMutex;
+    // gcMutex串行化gc与reset: tail只在持有它时读写，gc扫描期间vlog不会被reset删除
+    std::mutex gcMutex;
+    // group commit: syncedHead之前的vlog内容已落盘
+    SS_OFFSET_TL syncedHead = 0;
+    bool syncing = false;
+    bool stopSync = false;
+    // 每次reset加1，reset之前写入的entry连同vlog已被删除，不必再等待其落盘
+    // reset同时持有gcMutex、vlogReadMutex、memMutex与syncMutex时修改，
+    // 持有其一即可读取
+    uint64_t vlogGeneration = 0;
+    std::mutex syncMutex;  // 保护syncedHead/syncing/stopSync/vlogGeneration
+    std::condition_variable syncCv;
+    std::thread syncThread;  // 仅WalSyncMode::INTERVAL时启动
     // for ssTable
     FILE_NUM_TL largestUid;
     FILE_NUM_TL largestTimeStamp;
-    const int memTableLenThreshold =
-        (SS_MAX_FILE_BYTENUM - SS_HEADER_BYTENUM - SS_BLOOM_BYTENUM) /
-        (SS_KEY_BYTENUM + SS_OFFSET_BYTENUM + SS_VLEN_BYTENUM);
-    const int OPTION_1 = 0;
-    skiplist_type *memTable;
+    KVStoreOptions options;
+    // memTable的arena按块申请内存，块取memTableBytes的1/16(限制在
+    // [ARENA_MIN_BLOCK_BYTENUM, ARENA_DEFAULT_BLOCK_BYTENUM]内)，封存时的超出量不大
+    const size_t memTableArenaBytes;
+    // 由sstTargetBytes按每个entry SS_ENTRY_BYTENUM字节折算
+    const SST_HEADER_KVNUM_TL sstEntryNum;
+    memtable_type *memTable;
+    // 已满、等待后台线程flush的memTable，只读
+    memtable_type *immMemTable;
+    // memMutex保护memTable/immMemTable指针: put/get持共享锁，封存持独占锁
+    // levelMutex保护levelCache/sst/vlog head: flush线程是levelCache唯一的修改者，
+    // 生成与写出sst时持共享锁，只在替换levelCache中的元数据时持独占锁
+    // 加锁顺序: gcMutex -> vlogReadMutex -> memMutex -> levelMutex / vlogMutex,
+    // syncMutex -> vlogMutex; 持有memMutex的独占锁时不得等待levelMutex
+    std::shared_mutex memMutex;
+    std::shared_mutex levelMutex;
+    // immMemTable写入sst并被清空时加1，持有memMutex时读写;
+    // gc据此判断查找offset之后是否有memTable中的写入已移入sst
+    uint64_t flushEpoch = 0;
+    std::condition_variable_any flushCv;
+    std::thread flushThread;
+    bool stopFlush = false;
 
    public:
-    KVStore(const std::string &dir, const std::string &vlog);
+    KVStore(const std::string &dir, const std::string &vlog,
+            const KVStoreOptions &options = KVStoreOptions());
     ~KVStore();
 
     typedef uint64_t KEY_TYPE;
@@ -58,13 +110,12 @@ class KVStore : public KVStoreAPI {
             vlen = 0;
         }
     };
-    struct CacheItemProps {
-        BF bf;
-        int kvNum;
-        KEY_TL keyList[MAX_SST_KV_GROUP_NUM];
-        SS_OFFSET_TL offsetList[MAX_SST_KV_GROUP_NUM];
-        SS_VLEN_TL vlenList[MAX_SST_KV_GROUP_NUM];
-        SST_LEVEL_TL level;
+    // GcEntryProps - gc扫描时仍是最新的entry，value已读出(压缩的已解压)
+    struct GcEntryProps {
+        KEY_TL key;
+        SS_OFFSET_TL offset;
+        std::string value;
+        bool stale;
     };
     struct sstInfoItemProps {
         FILE_NUM_TL uid;
@@ -72,10 +123,15 @@ class KVStore : public KVStoreAPI {
         SST_HEADER_KVNUM_TL kvNum;
         KEY_TL minKey;
         KEY_TL maxKey;
-        KEY_TL keyList[MAX_SST_KV_GROUP_NUM];
-        SS_OFFSET_TL offsetList[MAX_SST_KV_GROUP_NUM];
-        SS_VLEN_TL vlenList[MAX_SST_KV_GROUP_NUM];
-        BF bf;
+        // 长度总与kvNum相同，sst大小由sstTargetBytes决定
+        std::vector<KEY_TL> keyList;
+        std::vector<SS_OFFSET_TL> offsetList;
+        std::vector<SS_VLEN_TL> vlenList;
+        SSTFilter filter;
+        RangeFilter rangeFilter;
+        LearnedIndex learnedIndex;
+        HashIndex hashIndex;
+        EytzingerIndex eytzinger;  // 只在tableCache中构建，不持久化
         // bool hasCached;
         sstInfoItemProps(FILE_NUM_TL _uid, FILE_NUM_TL _timeStamp,
                          SST_HEADER_KVNUM_TL _kvNum, KEY_TL _minKey,
@@ -88,94 +144,143 @@ class KVStore : public KVStoreAPI {
               kvNum(_kvNum),
               minKey(_minKey),
               maxKey(_maxKey),
-              bf() {
-            for (SST_HEADER_KVNUM_TL i = 0; i < kvNum; i++) {
-                keyList[i] = *_keyList;
-                offsetList[i] = _offsetList[i];
-                vlenList[i] = _vlenList[i];
-                bf.insert(keyList[i]);
-                _keyList++;
-            }
+              keyList(_keyList, std::next(_keyList, _kvNum)),
+              offsetList(_offsetList, _offsetList + _kvNum),
+              vlenList(_vlenList, _vlenList + _kvNum) {}
+        sstInfoItemProps() {}
+        // resizeEntries - 设置kvNum并使三个数组等长
+        void resizeEntries(SST_HEADER_KVNUM_TL n) {
+            kvNum = n;
+            keyList.resize(n);
+            offsetList.resize(n);
+            vlenList.resize(n);
+        }
+        // buildFilter - keyList填满后按kvNum一次性构建filter
+        void buildFilter(FilterType type, double bitsPerKey) {
+            filter = SSTFilter::build(type, keyList.data(), kvNum, bitsPerKey);
+        }
+        void buildRangeFilter(double bitsPerKey) {
+            rangeFilter = bitsPerKey > 0
+                              ? RangeFilter(keyList.data(), kvNum, bitsPerKey)
+                              : RangeFilter();
+        }
+        void buildKeyLayout(KeyLayout layout) {
+            eytzinger = layout == KeyLayout::EYTZINGER
+                            ? EytzingerIndex(keyList.data(), kvNum)
+                            : EytzingerIndex();
+        }
+        // cacheCharge - 放入tableCache时计入预算的字节数
+        size_t cacheCharge() const {
+            return sizeof(sstInfoItemProps) + kvNum * SS_ENTRY_BYTENUM +
+                   learnedIndex.byteNum() + hashIndex.byteNum() +
+                   eytzinger.byteNum();
         }
-        sstInfoItemProps() : bf() {}
-        sstInfoItemProps(const sstInfoItemProps &other)
-            : uid(other.uid),
-              timeStamp(other.timeStamp),
-              kvNum(other.kvNum),
-              minKey(other.minKey),
-              maxKey(other.maxKey),
-              bf(other.bf) {
-            for (SST_HEADER_KVNUM_TL i = 0; i < kvNum; i++) {
-                keyList[i] = other.keyList[i];
-                offsetList[i] = other.offsetList[i];
-                vlenList[i] = other.vlenList[i];
-            }
+        void buildLearnedIndex(bool enable) {
+            learnedIndex = enable ? LearnedIndex(keyList.data(), kvNum,
+                                                 LEARNED_INDEX_EPSILON)
+                                  : LearnedIndex();
+        }
+        void buildHashIndex(bool enable) {
+            hashIndex = enable ? HashIndex(keyList.data(), kvNum) : HashIndex();
         }
     };
-    struct PtrTrackProps {
-        std::vector<sstInfoItemProps> fileInfoList;
-        PtrTrackProps(std::vector<sstInfoItemProps> _fileInfoList)
-            : fileInfoList(std::move(_fileInfoList)) {}
+    // CachedSST - tableCache中一个sst的entry，按keyLayout只存原数组或压缩表示之一
+    struct CachedSST {
+        std::shared_ptr<const sstInfoItemProps> plain;
+        SuccinctEntries succinct;
+        size_t charge() const {
+            return plain ? plain->cacheCharge()
+                         : sizeof(CachedSST) + succinct.byteNum();
+        }
+    };
+    // SSTMetaProps - levelCache中常驻的sst元数据，entry数组在tableCache中
+    struct SSTMetaProps {
+        FILE_NUM_TL uid;
+        FILE_NUM_TL timeStamp;
+        SST_HEADER_KVNUM_TL kvNum;
+        KEY_TL minKey;
+        KEY_TL maxKey;
+        // 从sst读出的filter不拷贝bit，直接指向reader的映射
+        SSTFilter filter;
+        RangeFilter rangeFilter;
+        // sst的只读映射，随元数据常驻到sst被删除; entry数组不在tableCache中时
+        // 点查与读入entry都直接用它，不再逐次open/mmap/munmap
+        std::shared_ptr<const SSTReader> reader;
     };
     // for cache
-    std::unordered_map<FILE_NUM_TL, sstInfoItemProps *>
-        hashCachePtrByUid;  // map `uid` to cachePtr
-    std::vector<std::multimap<KEY_TL, sstInfoItemProps>>
+    std::vector<std::multimap<KEY_TL, SSTMetaProps>>
         levelCache;  // slippery. Ordered by: minKey
-    static std::vector<PtrTrackProps> ptrTracks;
-    // for priority_queue
-    struct TrackPointerProps {
-        FILE_NUM_TL fileIndex;
-        size_t CacheItemIndex;
-        size_t trackIndex;
+    TableCache<CachedSST> tableCache;
+    // MergeTrack - compaction的一路输入: 同一层中按minKey有序、区间不相交的sst
+    // 游标走到某个sst时才读入其entry，同一时刻只持有一个sst
+    struct MergeTrack {
+        FILE_NUM_TL level;
+        std::vector<const SSTMetaProps *> files;
+        size_t fileIndex = 0, pos = 0;
+        std::shared_ptr<const sstInfoItemProps> table;
 
-        TrackPointerProps(FILE_NUM_TL _fileIndex, size_t _CacheItemIndex,
-                          size_t _trackIndex)
-            : fileIndex(_fileIndex),
-              CacheItemIndex(_CacheItemIndex),
-              trackIndex(_trackIndex) {}
+        MergeTrack(FILE_NUM_TL _level, std::vector<const SSTMetaProps *> _files)
+            : level(_level), files(std::move(_files)) {}
+        KEY_TL key() const { return table->keyList[pos]; }
+        SS_OFFSET_TL offset() const { return table->offsetList[pos]; }
+        SS_VLEN_TL vlen() const { return table->vlenList[pos]; }
+        // open - 从fileIndex起读入第一个非空sst，track走完时返回false
+        bool open(KVStore &store);
+        bool next(KVStore &store);
     };
-    struct CompareForPointerQueue {
-        // to get minimum, just define `>`
-        bool operator()(const TrackPointerProps &a,
-                        const TrackPointerProps &b) const {
-            KEY_TL keya = ptrTracks[a.trackIndex]
-                              .fileInfoList[a.fileIndex]
-                              .keyList[a.CacheItemIndex],
-                   keyb = ptrTracks[b.trackIndex]
-                              .fileInfoList[b.fileIndex]
-                              .keyList[b.CacheItemIndex];
-            if (keya > keyb) return true;
-            if (keya < keyb) return false;
-            // keya == keyb
-            // SLIPPERY
-            return ptrTracks[a.trackIndex]
-                       .fileInfoList[a.fileIndex]
-                       .offsetList[a.CacheItemIndex] <
-                   ptrTracks[b.trackIndex]
-                       .fileInfoList[b.fileIndex]
-                       .offsetList[b.CacheItemIndex];
-            // SLIPPERY: 若不看offset，而根据uid/timestamp，可能存在反例
-            SS_TIMESTAMP_TL
-            timestampA =
-                ptrTracks[a.trackIndex].fileInfoList[a.fileIndex].timeStamp,
-            timestampB =
-                ptrTracks[b.trackIndex].fileInfoList[b.fileIndex].timeStamp;
-            if (timestampA != timestampB) return timestampA < timestampB;
-            // timestampA == timestampB
-            return ptrTracks[a.trackIndex].fileInfoList[a.fileIndex].uid <
-                   ptrTracks[b.trackIndex].fileInfoList[b.fileIndex].uid;
-        }
+    // CompactionIterator - 用败者树对各track做k路归并，按key升序产出;
+    // key相同时只产出offset最大(最新写入vlog)的entry
+    // SLIPPERY: 若不看offset，而根据uid/timestamp，可能存在反例
+    class CompactionIterator {
+       public:
+        CompactionIterator(KVStore &store, std::vector<MergeTrack> &tracks);
+        bool valid() const { return !tree.empty(); }
+        KEY_TL key() const { return tree.topKey(); }
+        SS_OFFSET_TL offset() const { return tracks[tree.top()].offset(); }
+        SS_VLEN_TL vlen() const { return tracks[tree.top()].vlen(); }
+        void next();
+
+       private:
+        KVStore &store;
+        std::vector<MergeTrack> &tracks;
+        LoserTree tree;
     };
 
+    memtable_type *newMemTable() {
+        switch (options.memTableRep) {
+            case MemTableRep::BTREE:
+                return new btree_memtable_type(memTableArenaBytes);
+            case MemTableRep::VECTOR:
+                return new vector_memtable_type();
+            default:
+                return new arena_skiplist_type(memTableArenaBytes);
+        }
+    }
     void clearMemTable() {
         if (memTable) delete memTable;
-        memTable = new skiplist_type();
+        memTable = newMemTable();
     }
-    void convertAndWriteMemTable();
+    void convertAndWriteMemTable(memtable_type *table);
+    void sealMemTable();
+    void flushMemTableSync(std::unique_lock<std::shared_mutex> &lock);
+    void flushLoop();
+    VlogPointer appendToVlog(uint64_t key, const std::string &s);
+    void syncVlog(SS_OFFSET_TL end, uint64_t generation);
+    void syncLoop();
+    void openVlog();
+    void closeVlog();
 
     void put(uint64_t key, const std::string &s) override;
+    VlogPointer putWithoutLock(uint64_t key, const std::string &s,
+                               std::unique_lock<std::shared_mutex> &lock);
     std::string get(uint64_t key);
+    std::optional<VlogPointer> getFromMemTables(uint64_t key);
+    // memTableFull - memTable占用的内存达到memTableBytes，写入前需先封存;
+    // 调用者需持有memMutex
+    bool memTableFull() {
+        return memTable->getLength() &&
+               memTable->memoryUsage() >= options.memTableBytes;
+    }
     void getOffset(uint64_t key, SS_OFFSET_TL *userOffsetPtr);
     bool del(uint64_t key) override;
     void reset() override;
@@ -188,93 +293,81 @@ class KVStore : public KVStoreAPI {
                           SS_OFFSET_TL *userOffsetPtr = nullptr);
     void fillCrcObj(std::vector<unsigned char> &crcObj, KEY_TYPE key,
                     VLEN_TYPE vlen, const VALUE_TYPE &value);
-    void writeVlogEntry(std::ofstream &vlogFile, const VLOG_MAGIC_TL &magic,
+    bool writeVlogEntry(int vlogFd, SS_OFFSET_TL offset,
+                        const VLOG_MAGIC_TL &magic,
                         const VLOG_CHECKSUM_TL &checksum, const KEY_TL &key,
                         const SS_VLEN_TL &vlen, const VALUE_TL &val);
-    void writeSSTEntry(std::ofstream &sstFile, const KEY_TL &key,
-                       const SS_OFFSET_TL &offset, const SS_VLEN_TL &vlen);
-    void readFileNGetFileItem(std::string filePath, sstInfoItemProps &fileItem);
-    void readHeaderPropsFromSST(std::ifstream &file,
-                                SSTHeaderProps &headerProps);
-    void readBFFromSST(std::ifstream &file, BF &bf);
-    void readEntryFromSST(std::ifstream &file, SSTEntryProps &entry,
-                          int entryIndex);
+    bool readSSTMeta(const std::string &filePath, FILE_NUM_TL uid,
+                     SSTMetaProps &meta, SS_OFFSET_TL &vlogEnd);
+    bool fillFileItemFromSST(const SSTReader &reader,
+                             sstInfoItemProps &fileItem);
+    bool readEntriesFromSST(const SSTReader &reader,
+                            sstInfoItemProps &fileItem);
     template <typename T>
     void readDataFromVlog(std::ifstream &file, T &userdata,
                           SS_OFFSET_TL offset);
     void readValStringFromVlog(std::ifstream &file, std::string &userString,
                                SS_OFFSET_TL offset, SS_VLEN_TL vlen);
-    SSTEntryProps findOffsetInSSTInfoItemPtr(sstInfoItemProps *sstInfoItemPtr,
-                                             KEY_TL key);
+    std::string sstFilePath(FILE_NUM_TL level, FILE_NUM_TL uid);
+    std::shared_ptr<const sstInfoItemProps> loadSST(FILE_NUM_TL level,
+                                                    const SSTMetaProps &meta,
+                                                    bool fillCache = true);
+    SSTMetaProps makeSSTMeta(FILE_NUM_TL level, sstInfoItemProps &item);
+    void installSST(FILE_NUM_TL level, SSTMetaProps meta);
+    void insertTableCache(std::shared_ptr<sstInfoItemProps> item);
+    SSTEntryProps findOffsetInCachedSST(const CachedSST &cached, KEY_TL key);
+    SSTEntryProps findOffsetInSSTInfoItemPtr(
+        const sstInfoItemProps *sstInfoItemPtr, KEY_TL key);
+    SSTEntryProps findOffsetInSSTFile(const std::string &filePath, KEY_TL key,
+                                      SS_TIMESTAMP_TL &timeStamp);
+    SSTEntryProps findOffsetInSSTReader(const SSTReader &reader, KEY_TL key);
     std::string getValueByOffsetnVlen(SS_OFFSET_TL offset, SS_VLEN_TL vlen);
     bool crcCheck(const VLOG_CHECKSUM_TL &curChecksum, const KEY_TL &curKey,
                   const SS_VLEN_TL &curVlen, const std::string &curValue);
     VLOG_CHECKSUM_TL calcChecksum(const KEY_TL &curKey,
                                   const SS_VLEN_TL &curVlen,
                                   const std::string &curValue);
-    void deleteSSTInDisknCache(FILE_NUM_TL uid, FILE_NUM_TL level,
-                               KEY_TL minKey);
-    void mergeFilesAndReturnKOVList(std::vector<PtrTrackProps> &ptrTracks,
-                                    std::list<KEY_TL> &keyList,
-                                    std::vector<SS_OFFSET_TL> &offsetList,
-                                    std::vector<SS_VLEN_TL> &vlenList,
-                                    FILE_NUM_TL targetLevel);
-    void generateSSTList(const std::list<KEY_TL> &keyList,
-                         const std::vector<SS_OFFSET_TL> &offsetList,
-                         const std::vector<SS_VLEN_TL> &vlenList,
-                         std::vector<sstInfoItemProps> &userSSTList,
-                         SS_TIMESTAMP_TL timestampToWrite);
+    void eraseSSTFromCache(FILE_NUM_TL uid, FILE_NUM_TL level, KEY_TL minKey);
+    void removeSSTFile(FILE_NUM_TL uid, FILE_NUM_TL level);
+    bool compactLevel(FILE_NUM_TL targetLevel);
+    void mergeTracksIntoLevel(std::vector<MergeTrack> &tracks,
+                              FILE_NUM_TL sonLevel,
+                              SS_TIMESTAMP_TL timestampToWrite,
+                              bool dropDeleted,
+                              std::vector<SSTMetaProps> &outputs);
+    void generateSSTListFromMemTable(memtable_type *table,
+                                     std::vector<sstInfoItemProps> &userSSTList,
+                                     SS_TIMESTAMP_TL timestampToWrite);
+    double filterBitsPerKey(FILE_NUM_TL level);
+    void fillMissingFilters();
+    FILE_NUM_TL maxFileNum(FILE_NUM_TL level);
+    bool hashIndexAt(FILE_NUM_TL level);
     void writeSSTToDisk(FILE_NUM_TL level, std::vector<sstInfoItemProps> &list);
-    void writeSSTToCache(FILE_NUM_TL level,
-                         std::vector<sstInfoItemProps> &list);
-    void writeKOVListToDiskAndCache(std::list<KEY_TL> &keyList,
-                                    std::vector<SS_OFFSET_TL> &offsetList,
-                                    std::vector<SS_VLEN_TL> &vlenList,
-                                    FILE_NUM_TL sonLevel,
-                                    SS_TIMESTAMP_TL maxTimeStampToWrite);
     void examineOld();
+    void examineVlogTail(std::ifstream &vlogFile);
+    void replayVlog(SS_OFFSET_TL offset);
     /*
      *debug utils and less important utils
      */
     void printSST(SST_LEVEL_TL level, FILE_NUM_TL uid);
     void printSSTCache(SST_LEVEL_TL level, FILE_NUM_TL uid);
     void printUidContainsWatchedKey();
-    bool checkTailCandidateValidity(int candidate);
-    static bool compareReorderVec(const sstInfoItemProps &a,
-                                  const sstInfoItemProps &b) {
-        if (a.timeStamp < b.timeStamp) return true;
-        if (a.timeStamp > b.timeStamp) return false;
-        return a.minKey < b.minKey;
+    bool checkTailCandidateValidity(SS_OFFSET_TL candidate);
+    static bool compareReorderVec(const SSTMetaProps *a,
+                                  const SSTMetaProps *b) {
+        if (a->timeStamp < b->timeStamp) return true;
+        if (a->timeStamp > b->timeStamp) return false;
+        return a->minKey < b->minKey;
     }
     SS_OFFSET_TL getHead() { return head; }
     SS_OFFSET_TL getTail() { return tail; }
-    void printQueue(
-        std::priority_queue<TrackPointerProps, std::vector<TrackPointerProps>,
-                            CompareForPointerQueue> &pointerQueue) {
-        std::cout << "\\";
-        while (!pointerQueue.empty()) {
-            TrackPointerProps top = pointerQueue.top();
-            std::cout << "Key: "
-                      << ptrTracks[top.trackIndex]
-                             .fileInfoList[top.fileIndex]
-                             .keyList[top.CacheItemIndex]
-                      << ", Timestamp: "
-                      << ptrTracks[top.trackIndex]
-                             .fileInfoList[top.fileIndex]
-                             .timeStamp
-                      << " - ";
-            pointerQueue.pop();
-        }
-        std::cout << "//";
-        fflush(stdout);
-    }
     void lookInMemtable(KEY_TL key);
     void moveToFirstMagicPos(std::ifstream &vlogFile,
                              SS_OFFSET_TL &tailCandidate) {
         if (tailCandidate == head) return;
         VLOG_MAGIC_TL tmpMagic;
         readDataFromVlog(vlogFile, tmpMagic, tailCandidate++);
-        while (tmpMagic != VLOG_DEFAULT_MAGIC_VAL) {
+        while (!IS_VLOG_MAGIC(tmpMagic)) {
             readDataFromVlog(vlogFile, tmpMagic, tailCandidate++);
             if (tailCandidate == head) return;
         }
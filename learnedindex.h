@@ -0,0 +1,108 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "sstblock.h"
+#include "type.h"
+
+// LearnedIndex - sst内keyList的分段线性模型(PLA)，预测key在keyList中的下标
+// 每段从一个key开始，斜率取"收缩锥"内的中值，段内每个key的预测误差不超过
+// epsilon; 超出时从该key另起一段(greedy shrinking cone，同FITing-tree)
+// 查询时先在段的首key上二分定位段，再在预测值±(epsilon+1)内二分
+class LearnedIndex {
+   public:
+    struct Segment {
+        KEY_TL firstKey;
+        double slope;
+        uint32_t firstPos;
+    };
+    uint32_t epsilon = 0;
+    std::vector<Segment> segments;
+
+    // 空模型: 不含任何信息，searchRange返回整个数组
+    LearnedIndex() = default;
+    // keys须严格升序
+    LearnedIndex(const KEY_TL *keys, size_t keyNum, uint32_t _epsilon)
+        : epsilon(_epsilon) {
+        size_t start = 0;
+        double slopeLow = 0, slopeHigh = 0;
+        for (size_t i = 1; i <= keyNum; i++) {
+            if (i < keyNum) {
+                double dx = double(keys[i] - keys[start]);
+                double dy = double(i - start);
+                double low = (dy - epsilon) / dx, high = (dy + epsilon) / dx;
+                if (i == start + 1) {
+                    slopeLow = low, slopeHigh = high;
+                    continue;
+                }
+                if (low <= slopeHigh && high >= slopeLow) {
+                    slopeLow = std::max(slopeLow, low);
+                    slopeHigh = std::min(slopeHigh, high);
+                    continue;
+                }
+            }
+            // [start, i)成为一段
+            double slope = i > start + 1 ? (slopeLow + slopeHigh) / 2 : 0;
+            segments.push_back({keys[start], slope, uint32_t(start)});
+            start = i;
+        }
+    }
+    bool empty() const { return segments.empty(); }
+    // searchRange - key若在keys[0..keyNum)中，则其下标在[left, right]内
+    void searchRange(KEY_TL key, size_t keyNum, int &left, int &right) const {
+        left = 0, right = int(keyNum) - 1;
+        if (segments.empty() || key < segments[0].firstKey) return;
+        // 最后一个firstKey <= key的段
+        size_t lo = 0, hi = segments.size() - 1;
+        while (lo < hi) {
+            size_t mid = (lo + hi + 1) / 2;
+            if (segments[mid].firstKey <= key)
+                lo = mid;
+            else
+                hi = mid - 1;
+        }
+        const Segment &seg = segments[lo];
+        double pos = seg.firstPos + seg.slope * double(key - seg.firstKey);
+        // 多留1个槽位，吸收浮点舍入; 先截断到[0, keyNum]再转int
+        double radius = double(epsilon) + 1;
+        double low = pos - radius, high = pos + radius;
+        if (low > 0) left = low < double(keyNum) ? int(low) : int(keyNum);
+        if (high < double(right)) right = high < 0 ? -1 : int(high);
+    }
+    size_t byteNum() const { return segments.size() * LEARNED_INDEX_SEGMENT_BYTENUM; }
+    // sst中的格式: [epsilon(u32)|segNum(u32)] + 每段 [firstKey(u64)|slope(f64)|firstPos(u32)]
+    void appendTo(std::string &buf) const {
+        sstblock::putFixed32(buf, epsilon);
+        sstblock::putFixed32(buf, uint32_t(segments.size()));
+        for (auto &seg : segments) {
+            sstblock::putFixed64(buf, seg.firstKey);
+            uint64_t slopeBits;
+            std::memcpy(&slopeBits, &seg.slope, sizeof(slopeBits));
+            sstblock::putFixed64(buf, slopeBits);
+            sstblock::putFixed32(buf, seg.firstPos);
+        }
+    }
+    // decodeFrom - 长度须恰好吻合，否则返回false
+    bool decodeFrom(const char *p, size_t bytes) {
+        if (bytes < 2 * sizeof(uint32_t)) return false;
+        epsilon = sstblock::getFixed32(p);
+        uint32_t segNum = sstblock::getFixed32(p + sizeof(uint32_t));
+        if (bytes != 2 * sizeof(uint32_t) +
+                         size_t(segNum) * LEARNED_INDEX_SEGMENT_BYTENUM)
+            return false;
+        p += 2 * sizeof(uint32_t);
+        segments.resize(segNum);
+        for (auto &seg : segments) {
+            seg.firstKey = sstblock::getFixed64(p);
+            uint64_t slopeBits = sstblock::getFixed64(p + sizeof(uint64_t));
+            std::memcpy(&seg.slope, &slopeBits, sizeof(slopeBits));
+            seg.firstPos = sstblock::getFixed32(p + 2 * sizeof(uint64_t));
+            p += LEARNED_INDEX_SEGMENT_BYTENUM;
+        }
+        return true;
+    }
+};
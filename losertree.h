@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "type.h"
+
+// LoserTree - k路归并的败者树，compaction与scan共用
+// 每路当前entry的key与seq内联存放在heads中，比较不经由输入间接访问;
+// 叶i对应节点i + k，节点n的孩子是2n与2n+1，内部节点1..k-1记录该处比赛的败者，
+// losers[0]记录总胜者。胜者推进后只需沿其叶到根重赛一次，约log2(k)次比较
+// key小者胜，key相同时seq大(较新)者胜，已走完的一路败给所有仍有数据的路
+class LoserTree {
+   private:
+    struct Head {
+        KEY_TL key;
+        uint64_t seq;
+        bool done;
+    };
+    std::vector<Head> heads;
+    std::vector<size_t> losers;
+    size_t k = 0;
+    size_t alive = 0;
+
+    bool beats(size_t a, size_t b) const {
+        const Head &ha = heads[a], &hb = heads[b];
+        if (ha.done != hb.done) return hb.done;
+        if (ha.key != hb.key) return ha.key < hb.key;
+        return ha.seq > hb.seq;
+    }
+    // buildNode - 返回以node为根的子树的胜者，败者留在节点上
+    size_t buildNode(size_t node) {
+        if (node >= k) return node - k;
+        size_t a = buildNode(2 * node), b = buildNode(2 * node + 1);
+        if (beats(a, b)) {
+            losers[node] = b;
+            return a;
+        }
+        losers[node] = a;
+        return b;
+    }
+    // replay - 叶i的entry变化后，沿路径与各节点上的败者重赛
+    void replay(size_t i) {
+        size_t winner = i;
+        for (size_t node = (i + k) / 2; node; node /= 2)
+            if (beats(losers[node], winner)) std::swap(losers[node], winner);
+        losers[0] = winner;
+    }
+
+   public:
+    // 初始k路都视为已走完，调用者用set填入各路首个entry后再build
+    explicit LoserTree(size_t _k)
+        : heads(_k, {0, 0, true}), losers(_k ? _k : 1), k(_k) {}
+    void set(size_t i, KEY_TL key, uint64_t seq) {
+        if (heads[i].done) alive++;
+        heads[i] = {key, seq, false};
+    }
+    void build() {
+        if (k) losers[0] = buildNode(1);
+    }
+    bool empty() const { return !alive; }
+    // top - 当前胜者所在的路，empty()时无意义
+    size_t top() const { return losers[0]; }
+    KEY_TL topKey() const { return heads[losers[0]].key; }
+    // replaceTop - 胜者一路推进到下一个entry
+    void replaceTop(KEY_TL key, uint64_t seq) {
+        size_t i = losers[0];
+        heads[i].key = key, heads[i].seq = seq;
+        replay(i);
+    }
+    // popTop - 胜者一路已走完
+    void popTop() {
+        size_t i = losers[0];
+        heads[i].done = true;
+        alive--;
+        replay(i);
+    }
+};
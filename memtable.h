@@ -0,0 +1,52 @@
+#ifndef MEMTABLE_H
+#define MEMTABLE_H
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <optional>
+#include <utility>
+
+#include "skiplist.h"
+
+namespace skiplist {
+
+// VlogPointer - value在vlog中的位置，vlen == 0 表示删除标记
+struct VlogPointer {
+    uint64_t offset;
+    uint32_t vlen;
+};
+
+// memtable_type - memTable的统一接口，KVStore只通过它访问memTable
+// 实现需允许多个线程并发put/get(KVStore在memMutex共享锁下调用)
+// 同一key重复put时以offset较大(较晚写入vlog)者为准
+class memtable_type {
+   public:
+    // Iterator - 按key升序逐个访问entry，不拷贝整张表
+    class Iterator {
+       public:
+        virtual ~Iterator() = default;
+        virtual bool valid() const = 0;
+        virtual void next() = 0;
+        virtual key_type key() const = 0;
+        virtual VlogPointer value() const = 0;
+    };
+
+    virtual ~memtable_type() = default;
+    // getLength - 当前key数量，可偏大(如未去重的重复key)，不可偏小
+    virtual int getLength() = 0;
+    virtual void put(key_type key, const VlogPointer &val) = 0;
+    virtual std::optional<VlogPointer> get(key_type key) const = 0;
+    // scan - 按key升序输出[key1, key2]内的所有entry
+    virtual void scan(uint64_t key1, uint64_t key2,
+                      std::list<std::pair<uint64_t, VlogPointer>> &list) = 0;
+    // newIterator - 只用于已seal的memTable，遍历期间不得再有put
+    virtual std::unique_ptr<Iterator> newIterator() const = 0;
+    virtual size_t memoryUsage() const = 0;
+    // seal - 封存为immMemTable时调用一次，之后不再有put
+    virtual void seal() {}
+};
+
+}  // namespace skiplist
+
+#endif  // MEMTABLE_H
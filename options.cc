@@ -0,0 +1,242 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <list>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test.h"
+
+// 在非默认的KVStoreOptions下跑一遍put/get/del/scan/gc，再重新打开检查
+class OptionsTest : public Test
+{
+private:
+	const uint64_t TEST_MAX = 1024 * 4;
+	const uint64_t GC_TRIGGER = 512;
+
+	// value - 偶数key的value高度重复，奇数key的几乎不可压缩，
+	// 开启vlogCompression时两种entry混在vlog中
+	static std::string value(uint64_t i, int round)
+	{
+		std::string s;
+		if (i % 2 == 0)
+		{
+			std::string unit = std::to_string(round) + "-" + std::to_string(i) + ";";
+			while (s.size() < i % 200 + 40)
+				s += unit;
+			return s;
+		}
+		uint64_t x = i * 0x9e3779b97f4a7c15ULL + round + 1;
+		for (uint64_t n = i % 60 + 40; n; --n)
+		{
+			x ^= x << 13, x ^= x >> 7, x ^= x << 17;
+			s.push_back(char('!' + x % 90));
+		}
+		return s;
+	}
+	// expected - prepare结束后: 3的倍数被覆盖，5的倍数被删除
+	static std::string expected(uint64_t i)
+	{
+		if (i % 5 == 0)
+			return "";
+		return value(i, i % 3 == 0);
+	}
+	void checkAll()
+	{
+		for (uint64_t i = 0; i < TEST_MAX; ++i)
+			EXPECTI(expected(i), store.get(i), i);
+		std::list<std::pair<uint64_t, std::string>> want, got;
+		for (uint64_t i = 0; i < TEST_MAX; ++i)
+			if (!expected(i).empty())
+				want.emplace_back(i, expected(i));
+		store.scan(0, TEST_MAX - 1, got);
+		EXPECT(want.size(), got.size());
+		EXPECT(true, want == got);
+	}
+
+public:
+	void prepare()
+	{
+		store.reset();
+
+		// key乱序写入并立即读回，VECTOR memTable的乱序区在读写交替下也要正确
+		for (uint64_t j = 0; j < TEST_MAX; ++j)
+		{
+			uint64_t i = j * 7919 % TEST_MAX;
+			store.put(i, value(i, 0));
+			EXPECTI(value(i, 0), store.get(i), i);
+		}
+		for (uint64_t i = 0; i < TEST_MAX; ++i)
+			EXPECTI(value(i, 0), store.get(i), i);
+		phase();
+
+		// 覆盖与删除产生的旧entry由gc回收，仍有效的entry被搬到vlog末尾
+		uint64_t lastOffset = utils::seek_data_block(vlog.c_str());
+		for (uint64_t i = 0; i < TEST_MAX; ++i)
+		{
+			if (i % 3 == 0)
+				store.put(i, value(i, 1));
+			if (i % 5 == 0)
+				store.del(i);
+			if (i % GC_TRIGGER == 0) [[unlikely]]
+				store.gc(64 * 1024);
+		}
+		store.gc(64 * 1024);
+		uint64_t curOffset = utils::seek_data_block(vlog.c_str());
+		EXPECT(true, curOffset > lastOffset);
+		checkAll();
+		phase();
+
+		report();
+	}
+	// test - 重新打开之后
+	void test()
+	{
+		checkAll();
+		phase();
+
+		report();
+	}
+
+	// reset_test - BATCH模式下写者等待落盘时reset清空vlog，写者不能一直等下去
+	void reset_test()
+	{
+		const int writers = 4;
+		const uint64_t puts = 128;
+		std::atomic<int> finished(0);
+		std::vector<std::thread> threads;
+		for (int t = 0; t < writers; ++t)
+			threads.emplace_back([&, t]()
+								 {
+				for (uint64_t i = 0; i < puts; ++i)
+					store.put(t * puts + i, value(i, 0));
+				finished++; });
+		for (int r = 0; r < 8; ++r)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+			store.reset();
+		}
+		for (auto &thread : threads)
+			thread.join();
+		EXPECT(writers, finished.load());
+		store.put(0, value(0, 1));
+		EXPECT(value(0, 1), store.get(0));
+		phase();
+
+		report();
+	}
+
+	OptionsTest(const std::string &dir, const std::string &vlog, bool v,
+				const KVStoreOptions &options) : Test(dir, vlog, v, options)
+	{
+	}
+};
+
+int main(int argc, char *argv[])
+{
+	bool verbose = (argc == 2 && std::string(argv[1]) == "-v");
+
+	std::cout << "Usage: " << argv[0] << " [-v]" << std::endl;
+	std::cout << "  -v: print extra info for failed tests [currently ";
+	std::cout << (verbose ? "ON" : "OFF") << "]" << std::endl;
+	std::cout << std::endl;
+	std::cout.flush();
+
+	std::vector<std::pair<std::string, KVStoreOptions>> configs;
+	KVStoreOptions options;
+	options.syncMode = WalSyncMode::INTERVAL;
+	options.syncIntervalMs = 1;
+	configs.emplace_back("Interval Sync", options);
+	options = KVStoreOptions();
+	options.syncMode = WalSyncMode::BATCH;
+	configs.emplace_back("Batch Sync", options);
+	options = KVStoreOptions();
+	options.memTableRep = MemTableRep::BTREE;
+	configs.emplace_back("BTree MemTable", options);
+	options = KVStoreOptions();
+	options.memTableRep = MemTableRep::VECTOR;
+	configs.emplace_back("Vector MemTable", options);
+	options = KVStoreOptions();
+	options.bloomBitsPerKey = 4;
+	configs.emplace_back("4 Bloom Bits per Key", options);
+	options = KVStoreOptions();
+	options.filterType = FilterType::BLOCKED_BLOOM;
+	configs.emplace_back("Blocked Bloom", options);
+	options = KVStoreOptions();
+	options.filterAllocation = FilterAllocation::MONKEY;
+	configs.emplace_back("Monkey", options);
+	options = KVStoreOptions();
+	options.filterAllocation = FilterAllocation::MONKEY;
+	options.lastLevelFilter = false;
+	configs.emplace_back("Monkey, No Last Level Filter", options);
+	options = KVStoreOptions();
+	options.filterType = FilterType::XOR;
+	configs.emplace_back("XOR Filter", options);
+	options = KVStoreOptions();
+	options.rangeBitsPerKey = 0;
+	configs.emplace_back("No Range Filter", options);
+	options = KVStoreOptions();
+	options.tableCacheBytes = 1;
+	configs.emplace_back("Tiny Table Cache", options);
+	// tableCache只放得下一部分sst，cache内外的sst都要查得到
+	options = KVStoreOptions();
+	options.learnedIndex = true;
+	options.tableCacheBytes = 16 * 1024;
+	configs.emplace_back("Learned Index", options);
+	options = KVStoreOptions();
+	options.keyLayout = KeyLayout::EYTZINGER;
+	options.tableCacheBytes = 16 * 1024;
+	configs.emplace_back("Eytzinger", options);
+	options = KVStoreOptions();
+	options.keyLayout = KeyLayout::SUCCINCT;
+	options.tableCacheBytes = 16 * 1024;
+	configs.emplace_back("Succinct", options);
+	options = KVStoreOptions();
+	options.hashIndexLevels = 0b101;
+	options.tableCacheBytes = 16 * 1024;
+	configs.emplace_back("Hash Index", options);
+	options = KVStoreOptions();
+	options.keyLayout = KeyLayout::EYTZINGER;
+	options.hashIndexLevels = 0b101;
+	options.tableCacheBytes = 16 * 1024;
+	configs.emplace_back("Eytzinger and Hash Index", options);
+	// 小memTable与小sst使数据分布到更多层，并频繁compaction
+	options = KVStoreOptions();
+	options.memTableBytes = 8 * 1024;
+	options.sstTargetBytes = 40 * SS_ENTRY_BYTENUM;
+	options.level0FileNum = 1;
+	options.levelSizeRatio = 3;
+	configs.emplace_back("Small MemTable and SST", options);
+	options = KVStoreOptions();
+	options.vlogCompression = VlogCompression::LZ;
+	configs.emplace_back("LZ Compression", options);
+	options = KVStoreOptions();
+	options.vlogCompression = VlogCompression::ZSTD;
+	configs.emplace_back("ZSTD Compression", options);
+
+	std::cout << "KVStore Options Test" << std::endl;
+	std::filesystem::create_directories("./data_options");
+	for (auto &[name, options] : configs)
+	{
+		std::cout << "[" << name << "]" << std::endl;
+		{
+			OptionsTest test("./data_options", "./data_options/vlog", verbose, options);
+			test.prepare();
+		}
+		OptionsTest test("./data_options", "./data_options/vlog", verbose, options);
+		test.test();
+	}
+	{
+		KVStoreOptions batch;
+		batch.syncMode = WalSyncMode::BATCH;
+		std::cout << "[Batch Sync Reset]" << std::endl;
+		OptionsTest test("./data_options", "./data_options/vlog", verbose, batch);
+		test.reset_test();
+	}
+	std::filesystem::remove_all("./data_options");
+
+	return 0;
+}
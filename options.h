@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "filter.h"
+#include "type.h"
+
+// WalSyncMode - vlog(兼作WAL)的落盘策略
+enum class WalSyncMode {
+    NONE,      // 只write，不主动fsync，由OS决定何时落盘
+    INTERVAL,  // 后台线程每syncIntervalMs毫秒fdatasync一次
+    BATCH,     // put返回前保证已落盘，并发写者合并为一次fdatasync
+};
+
+// MemTableRep - memTable的实现
+enum class MemTableRep {
+    SKIPLIST,  // 并发skiplist，通用
+    BTREE,     // B+树，读多写少、随机点查
+    VECTOR,    // 追加写vector，乱序key攒到上限才归并，适合批量导入递增key
+};
+
+// FilterAllocation - filter内存在各层之间的分配方式
+enum class FilterAllocation {
+    UNIFORM,  // 每层都用bloomBitsPerKey
+    MONKEY,   // 总预算不变，按各层容量分配，使零结果查询的期望误判次数最小
+};
+
+// KeyLayout - tableCache中sst key数组的查找结构
+enum class KeyLayout {
+    SORTED,     // 只保留有序数组，二分(有learned index时局部二分)
+    EYTZINGER,  // 进入tableCache时另建BFS排列，无分支下降并预取
+    SUCCINCT,   // 只存压缩表示: key用Elias-Fano，offset/vlen定宽压缩
+};
+
+// VlogCompression - 写入vlog时value的压缩方式，读取时按entry的magic自动识别
+enum class VlogCompression {
+    NONE,  // 原样写入
+    LZ,    // 内置的LZ77，不依赖外部库
+    ZSTD,  // 压缩率更高; 编译时没有zstd.h则退回LZ
+};
+
+// KVStoreOptions - 打开KVStore时可选的配置
+struct KVStoreOptions {
+    WalSyncMode syncMode = WalSyncMode::NONE;
+    uint32_t syncIntervalMs = 10;
+    MemTableRep memTableRep = MemTableRep::SKIPLIST;
+    // 每个key分配的bloom filter bit数，约10时误判率~1%
+    double bloomBitsPerKey = DEFAULT_BITS_PER_KEY;
+    // XOR与同误判率的BLOOM相比省约12%内存，但不受bloomBitsPerKey控制
+    FilterType filterType = FilterType::BLOOM;
+    FilterAllocation filterAllocation = FilterAllocation::UNIFORM;
+    // false时最深一层(不含第0层)不建filter，适合查询大多命中的负载
+    bool lastLevelFilter = true;
+    // range filter每个key的bit数，scan据此跳过区间内没有key的sst; 0表示不建
+    double rangeBitsPerKey = DEFAULT_BITS_PER_KEY;
+    // sst entry数组在内存中最多占用的字节数，超出时按LRU淘汰;
+    // 不在内存中时GET只读sst中所需的block，scan读入整个sst; 0表示不限制
+    // filter与key范围等元数据不计入，总是常驻
+    size_t tableCacheBytes = 0;
+    // 为每个sst建分段线性模型并随sst持久化，cache中的点查只需在预测位置附近
+    // 二分; 每段LEARNED_INDEX_SEGMENT_BYTENUM字节，key分布越平滑段数越少
+    bool learnedIndex = false;
+    // EYTZINGER每个key多占8字节; SUCCINCT约省到原数组的1/3~1/5，
+    // 点查稍慢，scan与合并需先解压整个sst; 均计入tableCacheBytes
+    KeyLayout keyLayout = KeyLayout::SORTED;
+    // 第i位为1时，写入第i层的sst内嵌hash index并随sst持久化，cache内外的点查
+    // 都只需O(1)次探测(不在cache中时直接在映射上探测); scan仍用有序数组;
+    // 每个key约多占11字节，计入tableCacheBytes; 这些sst在cache中不建EYTZINGER，
+    // 与SUCCINCT同用时cache中不保留hash index
+    uint64_t hashIndexLevels = 0;
+    // 压缩后更短时才以压缩形式写入，vlog更小，get读取的字节与GC搬移的数据更少
+    VlogCompression vlogCompression = VlogCompression::NONE;
+    // memTable占用的内存(memoryUsage)达到memTableBytes时封存并flush，
+    // 按sstTargetBytes(每个entry按SS_ENTRY_BYTENUM字节折算)切分成一个或多个sst;
+    // 默认的skiplist每个entry约占50字节; VECTOR按容量计，扩容时可能一次翻倍
+    size_t memTableBytes = 64 * 1024;
+    size_t sstTargetBytes = MAX_SST_KV_GROUP_NUM * SS_ENTRY_BYTENUM;
+    // 第0层最多level0FileNum个sst，第i层为其levelSizeRatio^i倍，超出时向下合并
+    uint32_t level0FileNum = 2;
+    uint32_t levelSizeRatio = 2;
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#include "bloomfilter.h"
+#include "type.h"
+
+// RangeFilter - 前缀bloom filter，回答"[key1, key2]内是否可能有key"
+// key右移shift位得到前缀，BF中存放所有key的前缀，查询时逐个探测区间覆盖的前缀
+// shift按sst内key的平均间隔选取，使前缀桶比平均间隔小约2^RANGE_FILTER_SHIFT_MARGIN倍:
+// 短区间只需探测少量前缀，边界桶中恰有区间外key的概率也很小
+class RangeFilter {
+   public:
+    uint32_t shift;
+    BF bf;
+    // 空filter: 不含任何信息，mayContain总是返回true
+    RangeFilter() : shift(0) {}
+    // keys须升序
+    RangeFilter(const uint64_t* keys, size_t keyNum, double bitsPerKey)
+        : shift(0), bf(keyNum, bitsPerKey) {
+        if (keyNum > 1) {
+            uint64_t gap = (keys[keyNum - 1] - keys[0]) / (keyNum - 1);
+            int log2Gap = gap ? 63 - __builtin_clzll(gap) : 0;
+            shift = std::max(0, log2Gap - RANGE_FILTER_SHIFT_MARGIN);
+        }
+        for (size_t i = 0; i < keyNum; i++) bf.insert(keys[i] >> shift);
+    }
+    // mayContain - 区间跨越的前缀过多时不再探测，直接返回true
+    bool mayContain(uint64_t key1, uint64_t key2) const {
+        if (!bf.m) return true;
+        uint64_t first = key1 >> shift, prefixNum = (key2 >> shift) - first;
+        if (prefixNum >= RANGE_FILTER_MAX_PROBENUM) return true;
+        for (uint64_t i = 0; i <= prefixNum; i++)
+            if (bf.query(first + i)) return true;
+        return false;
+    }
+    size_t byteNum() const { return bf.byteNum(); }
+    // sst中的格式: [shift(u32)|BF]
+    void writeTo(std::ostream& out) const {
+        out.write(reinterpret_cast<const char*>(&shift), sizeof(shift));
+        bf.writeTo(out);
+    }
+    // viewFrom - BF的bitArray不拷贝; 返回占用的字节数，格式不合法时返回0
+    size_t viewFrom(const char* p, size_t availBytes) {
+        if (availBytes < sizeof(shift)) return 0;
+        std::memcpy(&shift, p, sizeof(shift));
+        size_t bfBytes = shift < 64 ? bf.viewFrom(p + sizeof(shift),
+                                                  availBytes - sizeof(shift))
+                                    : 0;
+        if (!bfBytes) {
+            shift = 0;
+            return 0;
+        }
+        return sizeof(shift) + bfBytes;
+    }
+};
@@ -0,0 +1,215 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "type.h"
+
+// sst的block格式 (SS_FORMAT_VERSION 2):
+// [header][data block]...[index block][learned index][hash index][filter][range filter][footer]
+// data block: entry序列 + [restart偏移(u32)...][restart数(u32)]
+//   entry: [varint key差][varint zigzag(offset差)][varint vlen]
+//   每SS_BLOCK_RESTART_INTERVAL个entry一个restart point，其差值相对0，
+//   即直接存完整的key与offset，block内可按restart point二分
+// index block: [blockNum(u32)] + 每个block [lastKey(u64)|offset(u32)|bytes(u32)]
+// learned index: 可选，未建时长度为0，格式见LearnedIndex
+// hash index: 可选，未建时长度为0，以HASH_INDEX_MAGIC开头，格式见HashIndex
+// footer: [vlogEnd(u64)|indexOffset(u64)|filterOffset(u64)|version(u32)|magic(u32)]
+//   vlogEnd为sst中entry在vlog里的最大结束位置; version 1的footer没有这一项
+
+namespace sstblock {
+
+inline void putFixed32(std::string &buf, uint32_t v) {
+    buf.append(reinterpret_cast<const char *>(&v), sizeof(v));
+}
+inline void putFixed64(std::string &buf, uint64_t v) {
+    buf.append(reinterpret_cast<const char *>(&v), sizeof(v));
+}
+inline uint32_t getFixed32(const char *p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+inline uint64_t getFixed64(const char *p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+inline void putVarint(std::string &buf, uint64_t v) {
+    while (v >= 0x80) {
+        buf.push_back(char(v | 0x80));
+        v >>= 7;
+    }
+    buf.push_back(char(v));
+}
+// getVarint - 从[p, end)解码，成功时p移到其后
+inline bool getVarint(const char *&p, const char *end, uint64_t &v) {
+    v = 0;
+    for (int shift = 0; shift < 64 && p < end; shift += 7) {
+        uint8_t byte = uint8_t(*p++);
+        v |= uint64_t(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+// offset并不随key递增，差值可能为负，用zigzag使小的负数也只占1~2字节
+inline uint64_t zigzag(uint64_t delta) {
+    return (delta << 1) ^ uint64_t(int64_t(delta) >> 63);
+}
+inline uint64_t unzigzag(uint64_t v) { return (v >> 1) ^ (~(v & 1) + 1); }
+
+// BlockBuilder - 把升序的entry编码成一个data block
+class BlockBuilder {
+   private:
+    std::string buf;
+    std::vector<uint32_t> restarts;
+    uint32_t entryNum = 0;
+    KEY_TL lastKey = 0;
+    SS_OFFSET_TL lastOffset = 0;
+
+   public:
+    // 单个entry编码后的最大字节数
+    static constexpr size_t MAX_ENTRY_BYTENUM = 10 + 10 + 5;
+
+    bool empty() const { return entryNum == 0; }
+    KEY_TL getLastKey() const { return lastKey; }
+    // bytesAfterAdd - 再加一个entry后block最多占用的字节数
+    size_t bytesAfterAdd() const {
+        return buf.size() + MAX_ENTRY_BYTENUM +
+               sizeof(uint32_t) * (restarts.size() + 2);
+    }
+    void add(KEY_TL key, SS_OFFSET_TL offset, SS_VLEN_TL vlen) {
+        KEY_TL baseKey = lastKey;
+        SS_OFFSET_TL baseOffset = lastOffset;
+        if (entryNum % SS_BLOCK_RESTART_INTERVAL == 0) {
+            restarts.push_back(uint32_t(buf.size()));
+            baseKey = 0, baseOffset = 0;
+        }
+        putVarint(buf, key - baseKey);
+        putVarint(buf, zigzag(offset - baseOffset));
+        putVarint(buf, vlen);
+        lastKey = key, lastOffset = offset;
+        entryNum++;
+    }
+    // finish - 追加restart数组，返回block内容并清空builder
+    std::string finish() {
+        for (uint32_t restart : restarts) putFixed32(buf, restart);
+        putFixed32(buf, uint32_t(restarts.size()));
+        std::string block = std::move(buf);
+        buf.clear();
+        restarts.clear();
+        entryNum = 0;
+        lastKey = 0, lastOffset = 0;
+        return block;
+    }
+};
+
+// BlockReader - 解码一个data block，不拷贝block内容
+class BlockReader {
+   private:
+    const char *data = nullptr;
+    const char *entryEnd = nullptr;  // entry区结尾，即restart数组开头
+    uint32_t restartNum = 0;
+
+    uint32_t restartAt(uint32_t i) const {
+        return getFixed32(entryEnd + sizeof(uint32_t) * i);
+    }
+    // decodeFrom - 从restart point i开始依次解码，fn返回false时停止
+    template <typename FnT>
+    bool decodeFrom(uint32_t i, FnT fn) const {
+        const char *p = data + restartAt(i);
+        KEY_TL key = 0;
+        SS_OFFSET_TL offset = 0;
+        for (uint32_t n = 0; p < entryEnd; n++) {
+            uint64_t keyDelta, offsetDelta, vlen;
+            if (n % SS_BLOCK_RESTART_INTERVAL == 0) key = 0, offset = 0;
+            if (!getVarint(p, entryEnd, keyDelta) ||
+                !getVarint(p, entryEnd, offsetDelta) ||
+                !getVarint(p, entryEnd, vlen))
+                return false;
+            key += keyDelta;
+            offset += unzigzag(offsetDelta);
+            if (!fn(key, offset, SS_VLEN_TL(vlen))) return true;
+        }
+        return true;
+    }
+
+   public:
+    // init - block内容须在reader使用期间保持有效，格式不合法时返回false
+    bool init(const char *block, size_t bytes) {
+        if (bytes < sizeof(uint32_t)) return false;
+        data = block;
+        restartNum = getFixed32(data + bytes - sizeof(uint32_t));
+        size_t trailerBytes = sizeof(uint32_t) * (size_t(restartNum) + 1);
+        if (!restartNum || trailerBytes > bytes) return false;
+        entryEnd = data + bytes - trailerBytes;
+        for (uint32_t i = 0; i < restartNum; i++)
+            if (restartAt(i) >= size_t(entryEnd - data)) return false;
+        return true;
+    }
+    // forEach - 按顺序访问block内所有entry
+    template <typename FnT>
+    bool forEach(FnT fn) const {
+        return decodeFrom(0, [&](KEY_TL key, SS_OFFSET_TL offset,
+                                 SS_VLEN_TL vlen) {
+            fn(key, offset, vlen);
+            return true;
+        });
+    }
+    // entryAt - 第ordinal个entry，从它所在的restart point起顺序解码
+    bool entryAt(uint32_t ordinal, KEY_TL &key, SS_OFFSET_TL &offset,
+                 SS_VLEN_TL &vlen) const {
+        uint32_t restart = ordinal / SS_BLOCK_RESTART_INTERVAL;
+        if (restart >= restartNum) return false;
+        uint32_t skip = ordinal % SS_BLOCK_RESTART_INTERVAL, n = 0;
+        bool found = false;
+        decodeFrom(restart, [&](KEY_TL curKey, SS_OFFSET_TL curOffset,
+                                SS_VLEN_TL curVlen) {
+            if (n++ < skip) return true;
+            found = true, key = curKey, offset = curOffset, vlen = curVlen;
+            return false;
+        });
+        return found;
+    }
+    // seek - 先在restart point上二分，再在一个区间内顺序解码
+    bool seek(KEY_TL target, SS_OFFSET_TL &offset, SS_VLEN_TL &vlen) const {
+        uint32_t left = 0, right = restartNum - 1;
+        while (left < right) {
+            uint32_t mid = (left + right + 1) / 2;
+            const char *p = data + restartAt(mid);
+            uint64_t key;
+            if (!getVarint(p, entryEnd, key)) return false;
+            if (key <= target)
+                left = mid;
+            else
+                right = mid - 1;
+        }
+        bool found = false;
+        decodeFrom(left, [&](KEY_TL key, SS_OFFSET_TL curOffset,
+                             SS_VLEN_TL curVlen) {
+            if (key == target) found = true, offset = curOffset, vlen = curVlen;
+            return key < target;
+        });
+        return found;
+    }
+};
+
+// IndexEntry - index block中一个data block的描述
+struct IndexEntry {
+    KEY_TL lastKey;
+    uint32_t offset;
+    uint32_t bytes;
+};
+
+struct Footer {
+    uint64_t vlogEnd;
+    uint64_t indexOffset;
+    uint64_t filterOffset;
+    uint32_t version;
+    uint32_t magic;
+};
+static_assert(sizeof(Footer) == SS_FOOTER_BYTENUM);
+
+}  // namespace sstblock
@@ -0,0 +1,324 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "filter.h"
+#include "hashindex.h"
+#include "learnedindex.h"
+#include "rangefilter.h"
+#include "sstblock.h"
+#include "type.h"
+
+// SSTReader - 以mmap只读映射一个sst文件
+// footer/index直接从映射中取，data block在映射上原地解码，
+// 文件内容由page cache管理，不再经ifstream逐字段seekg/read
+// 映射建立后所有读取都是const的，可被多个线程共享
+class SSTReader {
+   private:
+    int fd = -1;
+    const char *data = nullptr;
+    size_t fileBytes = 0;
+    sstblock::Footer footer = {};
+    // version 1的footer没有vlogEnd，较短
+    size_t footerBytes = SS_FOOTER_BYTENUM;
+    bool blockFormat = false;
+    bool legacyFormat = false;
+    // 带block下标的hash index在映射中的位置，没有时为nullptr
+    const char *hashIndex = nullptr;
+    size_t hashIndexBytes = 0;
+    const char *blockStarts = nullptr;
+    uint32_t hashBlockNum = 0;
+
+    // parseFooter - 只有magic与version都匹配、各段偏移合法时才是block格式
+    // version与magic总在文件末尾，据version确定footer的长度
+    bool parseFooter() {
+        if (fileBytes < SS_HEADER_BYTENUM + SS_FOOTER_V1_BYTENUM) return false;
+        const char *tail = data + fileBytes - 2 * sizeof(uint32_t);
+        uint32_t version = sstblock::getFixed32(tail);
+        if (sstblock::getFixed32(tail + sizeof(uint32_t)) != SS_FOOTER_MAGIC ||
+            (version != 1 && version != SS_FORMAT_VERSION))
+            return false;
+        footerBytes = version == 1 ? SS_FOOTER_V1_BYTENUM : SS_FOOTER_BYTENUM;
+        if (fileBytes < SS_HEADER_BYTENUM + footerBytes) return false;
+        // version 1的footer对应Footer去掉开头vlogEnd的部分
+        char *dst = reinterpret_cast<char *>(&footer) + SS_FOOTER_BYTENUM -
+                    footerBytes;
+        std::memcpy(dst, data + fileBytes - footerBytes, footerBytes);
+        return footer.indexOffset >= SS_HEADER_BYTENUM &&
+               footer.indexOffset <= footer.filterOffset &&
+               footer.filterOffset <= fileBytes - footerBytes;
+    }
+    // isLegacyLayout - 旧格式没有footer，文件大小恰为
+    // header + bloom + kvNum个定长entry，据此与截断或未知的文件区分
+    bool isLegacyLayout() const {
+        return kvNum <= MAX_SST_KV_GROUP_NUM &&
+               fileBytes == SS_HEADER_BYTENUM + SS_LEGACY_BLOOM_BYTENUM +
+                                SS_ENTRY_BYTENUM * kvNum;
+    }
+
+   public:
+    SS_TIMESTAMP_TL timeStamp = 0;
+    SST_HEADER_KVNUM_TL kvNum = 0;
+    KEY_TL minKey = 0;
+    KEY_TL maxKey = 0;
+
+    SSTReader() = default;
+    SSTReader(const SSTReader &) = delete;
+    SSTReader &operator=(const SSTReader &) = delete;
+    ~SSTReader() {
+        if (data) munmap(const_cast<char *>(data), fileBytes);
+        if (fd >= 0) close(fd);
+    }
+    // open - 读取header并映射整个文件，
+    // 文件不存在、短于header或不属于任何已知格式时返回false
+    bool open(const std::string &path) { return openHeader(path) && map(); }
+    // openHeader - 只用一次pread读取header，不建立映射;
+    // 不经cache的GET对每个sst都要先判断key范围，多数sst到此为止
+    bool openHeader(const std::string &path) {
+        fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        char header[SS_HEADER_BYTENUM];
+        if (fstat(fd, &st) < 0 || size_t(st.st_size) < SS_HEADER_BYTENUM ||
+            pread(fd, header, SS_HEADER_BYTENUM, 0) != SS_HEADER_BYTENUM)
+            return false;
+        fileBytes = st.st_size;
+        timeStamp = sstblock::getFixed64(header);
+        kvNum = sstblock::getFixed64(header + SS_TIMESTAMP_BYTENUM);
+        minKey = sstblock::getFixed64(header + SS_TIMESTAMP_BYTENUM +
+                                      SS_KVNUM_BYTENUM);
+        maxKey = sstblock::getFixed64(header + SS_TIMESTAMP_BYTENUM +
+                                      SS_KVNUM_BYTENUM + SS_KEY_BYTENUM);
+        return true;
+    }
+    // map - 在openHeader之后映射整个文件并判断格式，之后才能读取其余部分
+    // 既不是block格式也不是旧格式时报错并返回false，不按任何格式猜测解析
+    bool map() {
+        void *p = mmap(nullptr, fileBytes, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        fd = -1;
+        if (p == MAP_FAILED) return false;
+        data = static_cast<const char *>(p);
+        blockFormat = parseFooter();
+        legacyFormat = !blockFormat && isLegacyLayout();
+        if (blockFormat) locateHashIndex();
+        if (blockFormat || legacyFormat) return true;
+        std::cerr << "ERR: unknown sst format\n";
+        return false;
+    }
+    bool isBlockFormat() const { return blockFormat; }
+    // vlogEnd - footer中记录的entry在vlog里的最大结束位置;
+    // 旧格式与version 1的sst没有记录，返回false，需解码entry自行计算
+    bool vlogEnd(SS_OFFSET_TL &end) const {
+        if (!blockFormat || footer.version == 1) return false;
+        end = footer.vlogEnd;
+        return true;
+    }
+    const sstblock::Footer &getFooter() const { return footer; }
+    // indexBytes - index block从indexOffset开始，其后到filterOffset为learned index
+    size_t indexBytes() const {
+        if (footer.filterOffset - footer.indexOffset < sizeof(uint32_t))
+            return 0;
+        uint32_t blockNum = sstblock::getFixed32(data + footer.indexOffset);
+        return sizeof(uint32_t) + size_t(blockNum) * SS_INDEX_ENTRY_BYTENUM;
+    }
+    bool readIndex(std::vector<sstblock::IndexEntry> &index) const {
+        const char *p = data + footer.indexOffset;
+        size_t bytes = indexBytes();
+        if (!bytes || bytes > footer.filterOffset - footer.indexOffset)
+            return false;
+        uint32_t blockNum = sstblock::getFixed32(p);
+        index.resize(blockNum);
+        p += sizeof(uint32_t);
+        for (auto &entry : index) {
+            entry.lastKey = sstblock::getFixed64(p);
+            entry.offset = sstblock::getFixed32(p + SS_KEY_BYTENUM);
+            entry.bytes =
+                sstblock::getFixed32(p + SS_KEY_BYTENUM + sizeof(uint32_t));
+            p += SS_INDEX_ENTRY_BYTENUM;
+            if (entry.offset < SS_HEADER_BYTENUM ||
+                uint64_t(entry.offset) + entry.bytes > footer.indexOffset)
+                return false;
+        }
+        return true;
+    }
+    // openBlock - reader直接指向映射中的block，SSTReader须比它活得久
+    bool openBlock(const sstblock::IndexEntry &entry,
+                   sstblock::BlockReader &reader) const {
+        return reader.init(data + entry.offset, entry.bytes);
+    }
+    // learnedIndexBytes - index block之后依次是可选的learned index与hash index，
+    // 后者以HASH_INDEX_MAGIC开头; learned index的长度由其段数决定
+    size_t learnedIndexBytes() const {
+        size_t begin = footer.indexOffset + indexBytes();
+        if (begin + 2 * sizeof(uint32_t) > footer.filterOffset ||
+            sstblock::getFixed32(data + begin) == HASH_INDEX_MAGIC)
+            return 0;
+        uint32_t segNum = sstblock::getFixed32(data + begin + sizeof(uint32_t));
+        return 2 * sizeof(uint32_t) +
+               size_t(segNum) * LEARNED_INDEX_SEGMENT_BYTENUM;
+    }
+    // readLearnedIndex - 未建learned index的sst返回空模型
+    bool readLearnedIndex(LearnedIndex &learnedIndex) const {
+        learnedIndex = LearnedIndex();
+        if (!blockFormat) return true;
+        size_t begin = footer.indexOffset + indexBytes();
+        if (begin >= footer.filterOffset) return begin == footer.filterOffset;
+        size_t bytes = learnedIndexBytes();
+        if (!bytes) return true;
+        return begin + bytes <= footer.filterOffset &&
+               learnedIndex.decodeFrom(data + begin, bytes);
+    }
+    // locateHashIndex - 记下hash index与其后block下标的位置，供find原地探测;
+    // 较早写入、没有block下标的hash index不用于find
+    void locateHashIndex() {
+        size_t index = indexBytes();
+        if (!index || index > footer.filterOffset - footer.indexOffset) return;
+        size_t begin = footer.indexOffset + index + learnedIndexBytes();
+        if (begin >= footer.filterOffset) return;
+        size_t bytes = footer.filterOffset - begin;
+        size_t n = HashIndex::slotBytes(data + begin, bytes);
+        if (!n || !HashIndex::blockStartsValid(data + begin + n, bytes - n,
+                                               kvNum))
+            return;
+        uint32_t starts = sstblock::getFixed32(data + begin + n);
+        if (starts != sstblock::getFixed32(data + footer.indexOffset)) return;
+        hashIndex = data + begin, hashIndexBytes = n;
+        blockStarts = data + begin + n + sizeof(uint32_t), hashBlockNum = starts;
+    }
+    // indexEntryAt - index block中第b个block的描述，偏移不合法时返回false
+    bool indexEntryAt(size_t b, sstblock::IndexEntry &entry) const {
+        const char *p = data + footer.indexOffset + sizeof(uint32_t) +
+                        SS_INDEX_ENTRY_BYTENUM * b;
+        entry.lastKey = sstblock::getFixed64(p);
+        entry.offset = sstblock::getFixed32(p + SS_KEY_BYTENUM);
+        entry.bytes = sstblock::getFixed32(p + SS_KEY_BYTENUM + sizeof(uint32_t));
+        return entry.offset >= SS_HEADER_BYTENUM &&
+               uint64_t(entry.offset) + entry.bytes <= footer.indexOffset;
+    }
+    // entryAt - 第i个entry: 二分block下标找到所在block，再从restart点解码
+    bool entryAt(uint32_t i, KEY_TL &key, SS_OFFSET_TL &offset,
+                 SS_VLEN_TL &vlen) const {
+        if (i >= kvNum || !hashBlockNum) return false;
+        uint32_t left = 0, right = hashBlockNum - 1;
+        while (left < right) {
+            uint32_t mid = (left + right + 1) / 2;
+            if (sstblock::getFixed32(blockStarts + sizeof(uint32_t) * mid) <= i)
+                left = mid;
+            else
+                right = mid - 1;
+        }
+        sstblock::IndexEntry entry;
+        sstblock::BlockReader blockReader;
+        uint32_t start = sstblock::getFixed32(blockStarts + sizeof(uint32_t) * left);
+        return indexEntryAt(left, entry) && openBlock(entry, blockReader) &&
+               blockReader.entryAt(i - start, key, offset, vlen);
+    }
+    // readHashIndex - 未建hash index的sst返回空索引
+    bool readHashIndex(HashIndex &hashIndex) const {
+        hashIndex = HashIndex();
+        if (!blockFormat) return true;
+        size_t begin = footer.indexOffset + indexBytes() + learnedIndexBytes();
+        if (begin >= footer.filterOffset) return begin == footer.filterOffset;
+        return hashIndex.decodeFrom(data + begin, footer.filterOffset - begin,
+                                    kvNum);
+    }
+    // legacyEntry - 旧格式的第i个entry，entry定长平铺在bloom之后
+    void legacyEntry(size_t i, KEY_TL &key, SS_OFFSET_TL &offset,
+                     SS_VLEN_TL &vlen) const {
+        const char *p = data + SS_HEADER_BYTENUM + SS_LEGACY_BLOOM_BYTENUM +
+                        SS_ENTRY_BYTENUM * i;
+        key = sstblock::getFixed64(p);
+        offset = sstblock::getFixed64(p + SS_KEY_BYTENUM);
+        vlen = sstblock::getFixed32(p + SS_KEY_BYTENUM + SS_OFFSET_BYTENUM);
+    }
+    // find - 直接在映射上查找key，不解码index、不分配内存、没有系统调用，
+    // 找到时才写入offset与vlen; 有hash index时原地探测，指纹相同才解码
+    // 对应的entry; 否则index是定长entry的数组，原地二分出
+    // 第一个lastKey >= key的block，再在该block内按restart点查找;
+    // 旧格式的entry同样定长，直接二分
+    bool find(KEY_TL key, SS_OFFSET_TL &offset, SS_VLEN_TL &vlen) const {
+        if (legacyFormat) {
+            const char *entries =
+                data + SS_HEADER_BYTENUM + SS_LEGACY_BLOOM_BYTENUM;
+            size_t left = 0, right = kvNum;
+            while (left < right) {
+                size_t mid = (left + right) / 2;
+                if (sstblock::getFixed64(entries + SS_ENTRY_BYTENUM * mid) < key)
+                    left = mid + 1;
+                else
+                    right = mid;
+            }
+            if (left == kvNum) return false;
+            KEY_TL found;
+            SS_OFFSET_TL foundOffset;
+            SS_VLEN_TL foundVlen;
+            legacyEntry(left, found, foundOffset, foundVlen);
+            if (found != key) return false;
+            offset = foundOffset, vlen = foundVlen;
+            return true;
+        }
+        if (hashIndex)
+            return HashIndex::probe(
+                hashIndex, hashIndexBytes, key, [&](uint32_t i) {
+                    KEY_TL found;
+                    SS_OFFSET_TL foundOffset;
+                    SS_VLEN_TL foundVlen;
+                    if (!entryAt(i, found, foundOffset, foundVlen) ||
+                        found != key)
+                        return false;
+                    offset = foundOffset, vlen = foundVlen;
+                    return true;
+                });
+        size_t bytes = indexBytes();
+        if (!bytes || bytes > footer.filterOffset - footer.indexOffset)
+            return false;
+        const char *index = data + footer.indexOffset + sizeof(uint32_t);
+        size_t blockNum = (bytes - sizeof(uint32_t)) / SS_INDEX_ENTRY_BYTENUM;
+        size_t left = 0, right = blockNum;
+        while (left < right) {
+            size_t mid = (left + right) / 2;
+            if (sstblock::getFixed64(index + SS_INDEX_ENTRY_BYTENUM * mid) < key)
+                left = mid + 1;
+            else
+                right = mid;
+        }
+        if (left == blockNum) return false;
+        sstblock::IndexEntry entry;
+        if (!indexEntryAt(left, entry)) return false;
+        sstblock::BlockReader blockReader;
+        return openBlock(entry, blockReader) &&
+               blockReader.seek(key, offset, vlen);
+    }
+    // readFilter - filter区依次是filter与range filter，
+    // 损坏时退化为不过滤; 旧格式只有header之后的bloom，没有range filter
+    // 读出的filter不拷贝bit，直接指向映射，须与本reader一同持有
+    void readFilter(SSTFilter &filter, RangeFilter &rangeFilter) const {
+        filter = SSTFilter();
+        rangeFilter = RangeFilter();
+        if (legacyFormat) {
+            filter = SSTFilter::legacy(data + SS_HEADER_BYTENUM);
+            return;
+        }
+        const char *p = data + footer.filterOffset;
+        size_t availBytes = fileBytes - footerBytes - footer.filterOffset;
+        size_t filterBytes = filter.viewFrom(p, availBytes);
+        if (!filterBytes) {
+            std::cerr << "ERR: invalid filter section in sst\n";
+            return;
+        }
+        if (filterBytes == availBytes) return;
+        if (!rangeFilter.viewFrom(p + filterBytes, availBytes - filterBytes)) {
+            std::cerr << "ERR: invalid range filter section in sst\n";
+            rangeFilter = RangeFilter();
+        }
+    }
+};
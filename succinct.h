@@ -0,0 +1,189 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "type.h"
+
+// bitWidth - 表示[0, maxValue]所需的最少bit数
+inline uint32_t bitWidth(uint64_t maxValue) {
+    return maxValue ? 64 - __builtin_clzll(maxValue) : 0;
+}
+
+// BitPackedArray - n个定宽width bit的无符号数紧密排列，可随机访问
+class BitPackedArray {
+   private:
+    std::vector<uint64_t> words;
+    uint32_t width = 0;
+
+    uint64_t mask() const {
+        return width == 64 ? ~uint64_t(0) : (uint64_t(1) << width) - 1;
+    }
+
+   public:
+    BitPackedArray() = default;
+    // 多留一个word，get跨word读取时不越界
+    BitPackedArray(size_t n, uint32_t _width)
+        : words((n * _width + 63) / 64 + 1), width(_width) {}
+    void set(size_t i, uint64_t v) {
+        if (!width) return;
+        size_t bit = i * width, w = bit / 64, shift = bit % 64;
+        words[w] |= v << shift;
+        if (shift + width > 64) words[w + 1] |= v >> (64 - shift);
+    }
+    uint64_t get(size_t i) const {
+        if (!width) return 0;
+        size_t bit = i * width, w = bit / 64, shift = bit % 64;
+        uint64_t v = words[w] >> shift;
+        if (shift + width > 64) v |= words[w + 1] << (64 - shift);
+        return v & mask();
+    }
+    size_t byteNum() const { return words.size() * sizeof(uint64_t); }
+};
+
+// EliasFano - 升序key的Elias-Fano编码，约 2 + log2(u/n) bit/key
+// 每个值(减去首key后)拆成低lowBits位与高位: 低位定宽存入lows;
+// 高位h的第i个元素在highs的第h + i位置1，同一高位的元素连续，桶之间以0分隔
+// select按ELIAS_FANO_SELECT_SAMPLE个1/0采样一次位置，点查只解码一个桶
+class EliasFano {
+   private:
+    KEY_TL base = 0;
+    size_t n = 0;
+    uint32_t lowBits = 0;
+    uint64_t maxHigh = 0;
+    size_t bitNum = 0;  // highs的有效bit数
+    BitPackedArray lows;
+    std::vector<uint64_t> highs;
+    std::vector<uint32_t> oneSamples;   // 第k * SAMPLE个1的位置
+    std::vector<uint32_t> zeroSamples;  // 第k * SAMPLE个0的位置
+
+    bool bitAt(size_t pos) const { return highs[pos / 64] >> (pos % 64) & 1; }
+    // select - 第rank个(从0计)值为bit的位的位置，调用者保证其存在
+    size_t select(bool bit, size_t rank) const {
+        size_t pos = (bit ? oneSamples : zeroSamples)[rank / ELIAS_FANO_SELECT_SAMPLE];
+        size_t remain = rank % ELIAS_FANO_SELECT_SAMPLE;
+        for (size_t w = pos / 64;; w++) {
+            uint64_t word = bit ? highs[w] : ~highs[w];
+            if (w == pos / 64) word &= ~uint64_t(0) << (pos % 64);
+            size_t count = __builtin_popcountll(word);
+            if (remain < count) {
+                for (; remain; remain--) word &= word - 1;
+                return w * 64 + __builtin_ctzll(word);
+            }
+            remain -= count;
+        }
+    }
+    // bucketStart - 高位为h的第一个元素在highs中的位置
+    size_t bucketStart(uint64_t h) const {
+        return h ? select(false, h - 1) + 1 : 0;
+    }
+
+   public:
+    EliasFano() = default;
+    // keys须严格升序
+    EliasFano(const KEY_TL *keys, size_t keyNum) : n(keyNum) {
+        if (!n) return;
+        base = keys[0];
+        uint64_t universe = keys[n - 1] - base;
+        lowBits = universe / n ? bitWidth(universe / n) - 1 : 0;
+        maxHigh = universe >> lowBits;
+        bitNum = n + maxHigh + 1;
+        lows = BitPackedArray(n, lowBits);
+        highs.assign((bitNum + 63) / 64, 0);
+        uint64_t lowMask = (uint64_t(1) << lowBits) - 1;
+        for (size_t i = 0; i < n; i++) {
+            uint64_t v = keys[i] - base;
+            lows.set(i, v & lowMask);
+            size_t pos = (v >> lowBits) + i;
+            highs[pos / 64] |= uint64_t(1) << (pos % 64);
+        }
+        size_t ones = 0, zeros = 0;
+        for (size_t pos = 0; pos < bitNum; pos++) {
+            size_t &count = bitAt(pos) ? ones : zeros;
+            auto &samples = bitAt(pos) ? oneSamples : zeroSamples;
+            if (count++ % ELIAS_FANO_SELECT_SAMPLE == 0) samples.push_back(pos);
+        }
+    }
+    size_t size() const { return n; }
+    // lowerBound - 第一个>= key的元素下标，没有时返回size()
+    size_t lowerBound(KEY_TL key) const {
+        if (!n || key <= base) return 0;
+        uint64_t v = key - base, h = v >> lowBits;
+        if (h > maxHigh) return n;
+        uint64_t low = v & ((uint64_t(1) << lowBits) - 1);
+        size_t pos = bucketStart(h), i = pos - h;
+        for (; pos < bitNum && bitAt(pos); pos++, i++)
+            if (lows.get(i) >= low) return i;
+        return i;
+    }
+    // forEach - 从下标begin起依次解码到end，每个元素只需读一个低位与移动一位
+    template <typename FnT>
+    void forEach(size_t begin, size_t end, FnT fn) const {
+        if (begin >= end) return;
+        size_t pos = select(true, begin);
+        for (size_t i = begin; i < end; pos++) {
+            if (!bitAt(pos)) continue;
+            fn(i, base + ((uint64_t(pos - i) << lowBits) | lows.get(i)));
+            i++;
+        }
+    }
+    KEY_TL at(size_t i) const {
+        return base + ((uint64_t(select(true, i) - i) << lowBits) | lows.get(i));
+    }
+    size_t byteNum() const {
+        return lows.byteNum() + highs.size() * sizeof(uint64_t) +
+               (oneSamples.size() + zeroSamples.size()) * sizeof(uint32_t);
+    }
+};
+
+// SuccinctEntries - 一个sst的entry的压缩内存表示，只用于tableCache
+// key用EliasFano; vlog offset并不随key递增，存与最小offset之差，
+// vlen原样存，二者都按实际最大值定宽压缩; 点查不解压整个sst
+class SuccinctEntries {
+   private:
+    EliasFano keys;
+    SS_OFFSET_TL minOffset = 0;
+    BitPackedArray offsets;
+    BitPackedArray vlens;
+
+   public:
+    SuccinctEntries() = default;
+    SuccinctEntries(const KEY_TL *keyList, const SS_OFFSET_TL *offsetList,
+                    const SS_VLEN_TL *vlenList, size_t kvNum)
+        : keys(keyList, kvNum) {
+        SS_OFFSET_TL maxOffset = 0;
+        SS_VLEN_TL maxVlen = 0;
+        minOffset = kvNum ? offsetList[0] : 0;
+        for (size_t i = 0; i < kvNum; i++) {
+            minOffset = std::min(minOffset, offsetList[i]);
+            maxOffset = std::max(maxOffset, offsetList[i]);
+            maxVlen = std::max(maxVlen, vlenList[i]);
+        }
+        offsets = BitPackedArray(kvNum, bitWidth(maxOffset - minOffset));
+        vlens = BitPackedArray(kvNum, bitWidth(maxVlen));
+        for (size_t i = 0; i < kvNum; i++) {
+            offsets.set(i, offsetList[i] - minOffset);
+            vlens.set(i, vlenList[i]);
+        }
+    }
+    size_t size() const { return keys.size(); }
+    bool find(KEY_TL key, SS_OFFSET_TL &offset, SS_VLEN_TL &vlen) const {
+        size_t i = keys.lowerBound(key);
+        if (i == keys.size() || keys.at(i) != key) return false;
+        offset = minOffset + offsets.get(i);
+        vlen = SS_VLEN_TL(vlens.get(i));
+        return true;
+    }
+    // decode - 解压[0, size())到三个数组
+    void decode(KEY_TL *keyList, SS_OFFSET_TL *offsetList,
+                SS_VLEN_TL *vlenList) const {
+        keys.forEach(0, keys.size(), [&](size_t i, KEY_TL key) {
+            keyList[i] = key;
+            offsetList[i] = minOffset + offsets.get(i);
+            vlenList[i] = SS_VLEN_TL(vlens.get(i));
+        });
+    }
+    size_t byteNum() const {
+        return keys.byteNum() + offsets.byteNum() + vlens.byteNum();
+    }
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "type.h"
+
+// TableCache - 以uid为键缓存sst的entry数组，按LRU淘汰
+// 各项charge之和超过capacity时从最久未用的一端淘汰; capacity为0表示不限制
+// value以shared_ptr交出，被淘汰的项在使用者释放前仍然有效
+// get在levelMutex的共享锁下并发调用，内部另用一把mutex保护
+template <typename ValueT>
+class TableCache {
+   private:
+    struct Handle {
+        FILE_NUM_TL uid;
+        std::shared_ptr<const ValueT> value;
+        size_t charge;
+    };
+    size_t capacity;
+    size_t usage = 0;
+    std::list<Handle> lru;  // 表头为最近使用
+    std::unordered_map<FILE_NUM_TL, typename std::list<Handle>::iterator> index;
+    uint64_t hitNum = 0, missNum = 0;
+    mutable std::mutex mutex;
+
+    void eraseLocked(typename std::list<Handle>::iterator it) {
+        usage -= it->charge;
+        index.erase(it->uid);
+        lru.erase(it);
+    }
+    void evictLocked() {
+        while (capacity && usage > capacity && !lru.empty())
+            eraseLocked(std::prev(lru.end()));
+    }
+
+   public:
+    explicit TableCache(size_t capacity = 0) : capacity(capacity) {}
+    // lookup - 命中时移到表头，未命中返回nullptr
+    std::shared_ptr<const ValueT> lookup(FILE_NUM_TL uid) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = index.find(uid);
+        if (it == index.end()) {
+            missNum++;
+            return nullptr;
+        }
+        hitNum++;
+        lru.splice(lru.begin(), lru, it->second);
+        return it->second->value;
+    }
+    // insert - 已有同一uid时替换
+    void insert(FILE_NUM_TL uid, std::shared_ptr<const ValueT> value,
+                size_t charge) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = index.find(uid);
+        if (it != index.end()) eraseLocked(it->second);
+        lru.push_front({uid, std::move(value), charge});
+        index[uid] = lru.begin();
+        usage += charge;
+        evictLocked();
+    }
+    void erase(FILE_NUM_TL uid) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = index.find(uid);
+        if (it != index.end()) eraseLocked(it->second);
+    }
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        lru.clear();
+        index.clear();
+        usage = 0;
+    }
+    size_t getUsage() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return usage;
+    }
+    uint64_t getHitNum() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return hitNum;
+    }
+    uint64_t getMissNum() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return missNum;
+    }
+};
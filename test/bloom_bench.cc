@@ -0,0 +1,146 @@
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../bloomfilter.h"
+#include "../xorfilter.h"
+
+// BoolArrayBF - 改写前的实现: 4096个bool，一次MurmurHash取两个位置
+class BoolArrayBF {
+   private:
+    static const int M = 4096;
+    bool bitArray[M] = {};
+
+   public:
+    void insert(const uint64_t &key) {
+        uint32_t hashRes[4];
+        MurmurHash3_x64_128(&key, sizeof(key), 1, hashRes);
+        bitArray[hashRes[0] % M] = true;
+        bitArray[hashRes[1] % M] = true;
+    }
+    bool query(const uint64_t &key) const {
+        uint32_t hashRes[4];
+        MurmurHash3_x64_128(&key, sizeof(key), 1, hashRes);
+        return bitArray[hashRes[0] % M] && bitArray[hashRes[1] % M];
+    }
+    size_t byteNum() const { return M; }
+};
+
+class BloomBench {
+   private:
+    // 与一个sst的entry数相同，filter按sst粒度构建
+    const size_t KEY_NUM = MAX_SST_KV_GROUP_NUM;
+    const size_t QUERY_NUM = 4000000;
+    std::vector<uint64_t> absentKeys;
+
+    // measure - filterNum个filter各由KEY_NUM个奇数key构建，
+    // 用偶数key(一定不存在)依次查询不同filter，统计误判率与单次探测耗时
+    template <typename FilterT, typename MakeFilterT, typename QueryT>
+    void measure(const std::string &name, size_t filterNum,
+                 MakeFilterT makeFilter, QueryT query) {
+        std::mt19937_64 gen(42);
+        std::vector<FilterT> filters;
+        filters.reserve(filterNum);
+        std::vector<uint64_t> keys(KEY_NUM);
+        for (size_t f = 0; f < filterNum; ++f) {
+            for (auto &key : keys) key = gen() | 1;
+            filters.push_back(makeFilter(keys));
+        }
+        uint64_t falsePositive = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < QUERY_NUM; ++i)
+            falsePositive += query(filters[(i * 7919) % filterNum],
+                                   absentKeys[i % absentKeys.size()]);
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double, std::nano> duration = end - start;
+
+        std::cout << name << ": " << filters[0].byteNum()
+                  << " bytes/filter, FPR = "
+                  << 100.0 * falsePositive / QUERY_NUM
+                  << "%, probe = " << duration.count() / QUERY_NUM << " ns"
+                  << std::endl;
+    }
+
+    void measureAll(size_t filterNum, double bitsPerKey) {
+        std::cout << filterNum << " filters x " << KEY_NUM << " keys, "
+                  << bitsPerKey << " bits/key" << std::endl;
+        measure<BoolArrayBF>(
+            "legacy bool[4096]   ", filterNum,
+            [](const std::vector<uint64_t> &keys) {
+                return insertAll(BoolArrayBF(), keys);
+            },
+            [](const BoolArrayBF &bf, uint64_t key) { return bf.query(key); });
+        measure<BF>(
+            "BF                  ", filterNum,
+            [&](const std::vector<uint64_t> &keys) {
+                return insertAll(BF(KEY_NUM, bitsPerKey), keys);
+            },
+            [](const BF &bf, uint64_t key) { return bf.query(key); });
+        measure<BlockedBF>(
+            "BlockedBF (scalar)  ", filterNum,
+            [&](const std::vector<uint64_t> &keys) {
+                return insertAll(BlockedBF(KEY_NUM, bitsPerKey), keys);
+            },
+            [](const BlockedBF &bf, uint64_t key) {
+                return bf.queryScalar(key);
+            });
+        measure<BlockedBF>(
+            "BlockedBF (dispatch)", filterNum,
+            [&](const std::vector<uint64_t> &keys) {
+                return insertAll(BlockedBF(KEY_NUM, bitsPerKey), keys);
+            },
+            [](const BlockedBF &bf, uint64_t key) { return bf.query(key); });
+    }
+
+    template <typename FilterT>
+    static FilterT insertAll(FilterT filter, const std::vector<uint64_t> &keys) {
+        for (uint64_t key : keys) filter.insert(key);
+        return filter;
+    }
+
+    // measureXor - XorFilter大小固定，与误判率相近(约11.5 bit/key)的BF对比
+    void measureXor(size_t filterNum) {
+        std::cout << filterNum << " filters x " << KEY_NUM
+                  << " keys, static filter" << std::endl;
+        measure<XorFilter>(
+            "XorFilter           ", filterNum,
+            [](const std::vector<uint64_t> &keys) {
+                return XorFilter(keys.data(), keys.size());
+            },
+            [](const XorFilter &xf, uint64_t key) { return xf.query(key); });
+        measure<BF>(
+            "BF (11.5 bits/key)  ", filterNum,
+            [&](const std::vector<uint64_t> &keys) {
+                return insertAll(BF(KEY_NUM, 11.5), keys);
+            },
+            [](const BF &bf, uint64_t key) { return bf.query(key); });
+    }
+
+   public:
+    BloomBench() {
+        std::mt19937_64 gen(7);
+        for (size_t i = 0; i < (1 << 20); ++i)
+            absentKeys.push_back(gen() & ~1ULL);
+    }
+
+    void start_test() {
+        std::cout << "Bloom Filter Microbenchmark (" << QUERY_NUM
+                  << " negative queries)" << std::endl;
+        // 少量filter常驻cache，只比较计算开销
+        for (double bitsPerKey : {4096.0 / MAX_SST_KV_GROUP_NUM, 10.0, 16.0})
+            measureAll(256, bitsPerKey);
+        // 大量filter远超LLC，每次查询都要访问内存
+        measureAll(65536, 10.0);
+        measureXor(256);
+        measureXor(65536);
+    }
+};
+
+int main(int argc, char *argv[]) {
+    BloomBench bench;
+    bench.start_test();
+    return 0;
+}
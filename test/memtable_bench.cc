@@ -0,0 +1,168 @@
+#include <malloc.h>
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../arena_skiplist.h"
+#include "../btree_memtable.h"
+#include "../skiplist.h"
+#include "../vector_memtable.h"
+
+using namespace skiplist;
+
+class MemTableBench {
+   private:
+    const uint64_t ENTRY_NUM = 200000;
+    const size_t VALUE_LEN = 32;
+    std::vector<uint64_t> keys;
+    std::vector<uint64_t> seqKeys;
+
+    static size_t heapInUse() { return mallinfo2().uordblks; }
+
+    // measure - value由makeValue生成: skiplist_type存value本体，
+    // memtable_type的各实现只存value在vlog中的位置
+    template <typename MemTableT, typename MakeValueT>
+    void measure(const std::string &name, const std::vector<uint64_t> &keys,
+                 MakeValueT makeValue) {
+        size_t heapBefore = heapInUse();
+        MemTableT *table = new MemTableT();
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (uint64_t key : keys) table->put(key, makeValue(key));
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> putDuration = end - start;
+        size_t heapAfter = heapInUse();
+
+        start = std::chrono::high_resolution_clock::now();
+        uint64_t hit = 0;
+        for (uint64_t key : keys) hit += table->get(key).has_value();
+        end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> getDuration = end - start;
+
+        start = std::chrono::high_resolution_clock::now();
+        delete table;
+        end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> freeDuration = end - start;
+
+        std::cout << name << ": "
+                  << double(heapAfter - heapBefore) / keys.size()
+                  << " bytes/entry, PUT = "
+                  << keys.size() / putDuration.count() << " ops/sec, GET = "
+                  << keys.size() / getDuration.count() << " ops/sec ("
+                  << hit << " hits), FREE = " << freeDuration.count()
+                  << " sec" << std::endl;
+    }
+
+    // measureInterleaved - 每次put后立即get同一key，与KVStore::put在
+    // memTable写满前先get旧值的访问模式一致; mismatch统计未读到最新offset的次数
+    template <typename MemTableT>
+    void measureInterleaved(const std::string &name) {
+        MemTableT table;
+        uint64_t mismatch = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (uint64_t i = 0; i < keys.size(); ++i) {
+            // 每个key写两次，第二次offset更大，需覆盖第一次
+            uint64_t key = keys[i % (keys.size() / 2)];
+            table.put(key, VlogPointer{i, uint32_t(VALUE_LEN)});
+            auto res = table.get(key);
+            mismatch += !res || res->offset != i;
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> duration = end - start;
+        std::cout << name << ": PUT+GET = " << keys.size() / duration.count()
+                  << " ops/sec, " << mismatch << " mismatches" << std::endl;
+    }
+
+    // measureConcurrent - threadNum个线程各自写入/读取keys的不相交分片
+    template <typename MemTableT>
+    void measureConcurrent(const std::string &name, unsigned threadNum) {
+        MemTableT table;
+        uint64_t shard = keys.size() / threadNum;
+        auto runShards = [&](auto &&op) {
+            std::vector<std::thread> threads;
+            auto start = std::chrono::high_resolution_clock::now();
+            for (unsigned t = 0; t < threadNum; ++t) {
+                threads.emplace_back([&, t]() {
+                    for (uint64_t i = t * shard; i < (t + 1) * shard; ++i)
+                        op(keys[i]);
+                });
+            }
+            for (auto &thread : threads) thread.join();
+            auto end = std::chrono::high_resolution_clock::now();
+            std::chrono::duration<double> duration = end - start;
+            return shard * threadNum / duration.count();
+        };
+        double putThroughput =
+            runShards([&](uint64_t key) {
+                table.put(key, VlogPointer{key, uint32_t(VALUE_LEN)});
+            });
+        double getThroughput = runShards([&](uint64_t key) { table.get(key); });
+
+        std::cout << name << " x" << threadNum
+                  << " threads: PUT = " << putThroughput
+                  << " ops/sec, GET = " << getThroughput << " ops/sec, "
+                  << table.getLength() << " entries" << std::endl;
+    }
+
+   public:
+    MemTableBench() {
+        std::mt19937_64 gen(42);
+        for (uint64_t i = 0; i < ENTRY_NUM; ++i) keys.push_back(gen());
+        for (uint64_t i = 0; i < ENTRY_NUM; ++i) seqKeys.push_back(i);
+    }
+
+    template <typename MemTableT>
+    void measureRep(const std::string &name,
+                    const std::vector<uint64_t> &keys) {
+        measure<MemTableT>(name, keys, [&](uint64_t key) {
+            return VlogPointer{key, uint32_t(VALUE_LEN)};
+        });
+    }
+
+    void start_test() {
+        std::string value(VALUE_LEN, 's');
+        std::cout << "MemTable Microbenchmark (" << ENTRY_NUM
+                  << " random keys, " << VALUE_LEN << "-byte values)"
+                  << std::endl;
+        measure<skiplist_type>("skiplist_type       ", keys,
+                               [&](uint64_t) { return value; });
+        measureRep<arena_skiplist_type>("arena_skiplist_type ", keys);
+        measureRep<btree_memtable_type>("btree_memtable_type ", keys);
+        measureRep<vector_memtable_type>("vector_memtable_type", keys);
+
+        std::cout << "MemTable Microbenchmark (" << ENTRY_NUM
+                  << " sequential keys)" << std::endl;
+        measureRep<arena_skiplist_type>("arena_skiplist_type ", seqKeys);
+        measureRep<btree_memtable_type>("btree_memtable_type ", seqKeys);
+        measureRep<vector_memtable_type>("vector_memtable_type", seqKeys);
+
+        std::cout << "Interleaved PUT/GET (" << ENTRY_NUM
+                  << " random keys, each written twice)" << std::endl;
+        measureInterleaved<arena_skiplist_type>("arena_skiplist_type ");
+        measureInterleaved<btree_memtable_type>("btree_memtable_type ");
+        measureInterleaved<vector_memtable_type>("vector_memtable_type");
+
+        unsigned maxThreads = std::max(4u, std::thread::hardware_concurrency());
+        std::cout << "Concurrent MemTable (hardware_concurrency = "
+                  << std::thread::hardware_concurrency() << ")" << std::endl;
+        for (unsigned threadNum = 1; threadNum <= maxThreads; threadNum *= 2) {
+            measureConcurrent<arena_skiplist_type>("arena_skiplist_type ",
+                                                   threadNum);
+            measureConcurrent<btree_memtable_type>("btree_memtable_type ",
+                                                   threadNum);
+            measureConcurrent<vector_memtable_type>("vector_memtable_type",
+                                                    threadNum);
+        }
+    }
+};
+
+int main(int argc, char *argv[]) {
+    MemTableBench bench;
+    bench.start_test();
+    return 0;
+}
@@ -0,0 +1,123 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../eytzinger.h"
+#include "../learnedindex.h"
+#include "../succinct.h"
+
+// SortedKeys - 与tableCache中一个sst的keyList相同: 有序、定长
+struct SortedKeys {
+    std::vector<KEY_TL> keys;
+    LearnedIndex learned;
+    EytzingerIndex eytzinger;
+    SuccinctEntries succinct;  // offset/vlen取0，只比较key的查找
+};
+
+class SearchBench {
+   private:
+    // 与一个sst的entry数相同，查找按sst粒度进行
+    const size_t KEY_NUM = MAX_SST_KV_GROUP_NUM;
+    const size_t QUERY_NUM = 4000000;
+
+    // binarySearch - 与findOffsetInSSTInfoItemPtr相同的二分
+    static int binarySearch(const KEY_TL *keys, int left, int right,
+                            KEY_TL key) {
+        while (left <= right) {
+            int mid = (left + right) / 2;
+            if (key < keys[mid])
+                right = mid - 1;
+            else if (key > keys[mid])
+                left = mid + 1;
+            else
+                return mid;
+        }
+        return -1;
+    }
+
+    // measure - tableNum个key数组，用随机的已有key依次查询不同数组，
+    // 统计单次查找耗时; checksum防止查找被优化掉
+    template <typename FindT>
+    void measure(const std::string &name, const std::vector<SortedKeys> &tables,
+                 FindT find) {
+        std::mt19937_64 gen(42);
+        std::vector<std::pair<uint32_t, KEY_TL>> queries(QUERY_NUM);
+        for (auto &query : queries) {
+            query.first = gen() % tables.size();
+            query.second = tables[query.first].keys[gen() % KEY_NUM];
+        }
+        uint64_t checksum = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (auto &query : queries)
+            checksum += find(tables[query.first], query.second);
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double, std::nano> duration = end - start;
+        std::cout << name << ": " << duration.count() / QUERY_NUM
+                  << " ns/lookup (checksum " << checksum << ")" << std::endl;
+    }
+
+    void measureAll(size_t tableNum) {
+        std::mt19937_64 gen(7);
+        std::vector<SortedKeys> tables(tableNum);
+        for (auto &table : tables) {
+            for (size_t i = 0; i < KEY_NUM; i++) table.keys.push_back(gen() >> 16);
+            std::sort(table.keys.begin(), table.keys.end());
+            table.learned =
+                LearnedIndex(table.keys.data(), KEY_NUM, LEARNED_INDEX_EPSILON);
+            table.eytzinger = EytzingerIndex(table.keys.data(), KEY_NUM);
+            std::vector<SS_OFFSET_TL> offsets(KEY_NUM);
+            std::vector<SS_VLEN_TL> vlens(KEY_NUM);
+            table.succinct = SuccinctEntries(table.keys.data(), offsets.data(),
+                                             vlens.data(), KEY_NUM);
+        }
+        std::cout << tableNum << " tables x " << KEY_NUM << " keys ("
+                  << tableNum * KEY_NUM * sizeof(KEY_TL) / 1024 << " KB)"
+                  << std::endl;
+        measure("binary search ", tables,
+                [](const SortedKeys &table, KEY_TL key) {
+                    return binarySearch(table.keys.data(), 0,
+                                        int(table.keys.size()) - 1, key);
+                });
+        measure("learned index ", tables,
+                [](const SortedKeys &table, KEY_TL key) {
+                    int left, right;
+                    table.learned.searchRange(key, table.keys.size(), left,
+                                              right);
+                    return binarySearch(table.keys.data(), left, right, key);
+                });
+        measure("eytzinger     ", tables,
+                [](const SortedKeys &table, KEY_TL key) {
+                    return table.eytzinger.find(key);
+                });
+        measure("elias-fano    ", tables,
+                [](const SortedKeys &table, KEY_TL key) {
+                    SS_OFFSET_TL offset;
+                    SS_VLEN_TL vlen;
+                    return int(table.succinct.find(key, offset, vlen));
+                });
+        std::cout << "elias-fano keys: "
+                  << double(tables[0].succinct.byteNum()) / KEY_NUM
+                  << " B/key vs " << sizeof(KEY_TL) << " B/key sorted"
+                  << std::endl;
+    }
+
+   public:
+    void start_test() {
+        std::cout << "SST Key Search Microbenchmark (" << QUERY_NUM
+                  << " positive lookups)" << std::endl;
+        // 少量数组常驻L1/L2，只比较计算与分支开销
+        measureAll(4);
+        // 大量数组远超LLC，每次查找都要访问内存
+        measureAll(8192);
+    }
+};
+
+int main(int argc, char *argv[]) {
+    SearchBench bench;
+    bench.start_test();
+    return 0;
+}
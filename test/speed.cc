@@ -1,9 +1,14 @@
 #include <assert.h>
 
+#include <algorithm>
 #include <chrono>
+#include <ctime>
 #include <cstdint>
+#include <fstream>
 #include <iostream>
+#include <random>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "../test.h"
@@ -155,6 +160,7 @@ class SpeedTest : public Test {
         }
 
         uint64_t put_count = 0;
+        std::vector<double> latencies;
         auto start_time = std::chrono::high_resolution_clock::now();
         auto last_time = start_time;
 
@@ -164,6 +170,7 @@ class SpeedTest : public Test {
             auto end = std::chrono::high_resolution_clock::now();
             std::chrono::duration<double, std::micro> latency = end - start;
             latency_file << latency.count() << std::endl;
+            latencies.push_back(latency.count());
 
             put_count++;
             auto current_time = std::chrono::high_resolution_clock::now();
@@ -182,6 +189,453 @@ class SpeedTest : public Test {
 
         latency_file.close();
         throughput_file.close();
+
+        std::sort(latencies.begin(), latencies.end());
+        std::cout << "PUT (with Compaction): p50 = "
+                  << latencies[latencies.size() / 2] << " us, p99 = "
+                  << latencies[latencies.size() * 99 / 100]
+                  << " us, max = " << latencies.back() << " us" << std::endl;
+    }
+
+    // measure_concurrent - threadNum个客户端线程并发put/get，
+    // key集中在memTable阈值之内，负载始终驻留在memTable
+    void measure_concurrent(unsigned threadNum, uint64_t max) {
+        const uint64_t keyRange = 512;
+        std::vector<std::thread> threads;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (unsigned t = 0; t < threadNum; ++t) {
+            threads.emplace_back([this, t, max, keyRange]() {
+                for (uint64_t i = 0; i < max; ++i) {
+                    uint64_t key = (i * 131 + t) % keyRange;
+                    if (i & 1)
+                        store.get(key);
+                    else
+                        store.put(key, std::string(64, 'a' + t % 26));
+                }
+            });
+        }
+        for (auto &thread : threads) thread.join();
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> duration = end - start;
+        double throughput = threadNum * max / duration.count();
+
+        std::cout << "PUT/GET x" << threadNum
+                  << " threads: Throughput = " << throughput << " ops/sec"
+                  << std::endl;
+    }
+
+    // ScratchDir - 基准测试使用的独立目录，不与store共用vlog;
+    // 构造时创建并清空，析构时reset后删除
+    struct ScratchDir {
+        const std::string dir, vlog;
+        explicit ScratchDir(const std::string &_dir)
+            : dir(_dir), vlog(_dir + "/vlog") {
+            utils::mkdir(dir);
+            KVStore(dir, vlog).reset();
+        }
+        ~ScratchDir() {
+            KVStore(dir, vlog).reset();
+            utils::rmfile(vlog);
+            utils::rmdir(dir);
+        }
+    };
+
+    // nextKey - 各基准测试共用的LCG，seed相同时生成相同的48位key序列
+    static uint64_t nextKey(uint64_t &seed) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        return seed >> 16;
+    }
+
+    // loadRandomKeys - 以options打开scratch写入max个随机key(key经keyFn变换)，
+    // 关闭时后台flush/compaction已结束，重新打开后levelCache不再变化
+    template <typename KeyFnT>
+    void loadRandomKeys(const ScratchDir &scratch,
+                        const KVStoreOptions &options, uint64_t max,
+                        const std::string &value, KeyFnT keyFn) {
+        KVStore loadStore(scratch.dir, scratch.vlog, options);
+        for (uint64_t i = 0, seed = 1; i < max; ++i)
+            loadStore.put(keyFn(i, nextKey(seed)), value);
+    }
+    void loadRandomKeys(const ScratchDir &scratch,
+                        const KVStoreOptions &options, uint64_t max) {
+        loadRandomKeys(scratch, options, max, "v",
+                       [](uint64_t, uint64_t key) { return key; });
+    }
+
+    // measure_wal_sync - 不同落盘策略下threadNum个线程并发put的吞吐
+    void measure_wal_sync(const std::string &name, WalSyncMode mode,
+                          unsigned threadNum, uint64_t max) {
+        ScratchDir scratch("./data_wal");
+        KVStoreOptions options;
+        options.syncMode = mode;
+        {
+            KVStore walStore(scratch.dir, scratch.vlog, options);
+            std::vector<std::thread> threads;
+            auto start = std::chrono::high_resolution_clock::now();
+            for (unsigned t = 0; t < threadNum; ++t) {
+                threads.emplace_back([&walStore, t, threadNum, max]() {
+                    for (uint64_t i = t; i < max; i += threadNum)
+                        walStore.put(i, std::string(128, 's'));
+                });
+            }
+            for (auto &thread : threads) thread.join();
+            auto end = std::chrono::high_resolution_clock::now();
+            std::chrono::duration<double> duration = end - start;
+
+            std::cout << "PUT (" << name << ", x" << threadNum
+                      << " threads): Throughput = " << max / duration.count()
+                      << " ops/sec" << std::endl;
+        }
+    }
+
+    // measure_flush - 只计时memTable -> sst的转换，每两次flush后reset，
+    // 使level 0不触发compaction
+    void measure_flush(uint64_t rounds) {
+        const int entryNum = MAX_SST_KV_GROUP_NUM;
+        std::chrono::duration<double> wallTime(0);
+        std::clock_t cpuTime = 0;
+        uint64_t seed = 1;
+        for (uint64_t r = 0; r < rounds; ++r) {
+            if (r % 2 == 0) store.reset();
+            arena_skiplist_type table;
+            for (int i = 0; i < entryNum; ++i)
+                table.put(nextKey(seed), VlogPointer{uint64_t(i) * 160, 128});
+            std::clock_t cpuStart = std::clock();
+            auto start = std::chrono::high_resolution_clock::now();
+            store.convertAndWriteMemTable(&table);
+            auto end = std::chrono::high_resolution_clock::now();
+            cpuTime += std::clock() - cpuStart;
+            wallTime += end - start;
+        }
+        std::cout << "FLUSH (" << entryNum << " entries): Average Latency = "
+                  << wallTime.count() / rounds * 1e6 << " us, CPU = "
+                  << double(cpuTime) / CLOCKS_PER_SEC / rounds * 1e6
+                  << " us" << std::endl;
+    }
+
+    // measure_compaction - 先以很大的第0层上限写入max个随机key，使sst全部留在
+    // 第0层; 再以默认上限重新打开并flush一次，把第0层一次性合并到第1层:
+    // 统计归并吞吐(参与合并的entry数/耗时)
+    void measure_compaction(uint64_t max) {
+        ScratchDir scratch("./data_compact");
+        KVStoreOptions loadOptions;
+        loadOptions.level0FileNum = 1 << 20;
+        loadRandomKeys(scratch, loadOptions, max);
+        // 第1层不再向下合并，只计这一次合并
+        KVStoreOptions options;
+        options.levelSizeRatio = 1 << 20;
+        {
+            KVStore compactStore(scratch.dir, scratch.vlog, options);
+            size_t sstNum = compactStore.levelCache[0].size() + 1;
+            uint64_t entryNum = 0;
+            for (auto &[minKey, meta] : compactStore.levelCache[0])
+                entryNum += meta.kvNum;
+            arena_skiplist_type table;
+            for (uint64_t i = 0; i < MAX_SST_KV_GROUP_NUM; ++i)
+                table.put(i, VlogPointer{0, 1});
+            entryNum += MAX_SST_KV_GROUP_NUM;
+            auto start = std::chrono::high_resolution_clock::now();
+            compactStore.convertAndWriteMemTable(&table);
+            auto end = std::chrono::high_resolution_clock::now();
+            std::chrono::duration<double> duration = end - start;
+            std::cout << "COMPACTION (" << sstNum << " ssts, " << entryNum
+                      << " entries): Throughput = "
+                      << entryNum / duration.count() << " keys/s"
+                      << std::endl;
+        }
+    }
+
+    // measure_filter_allocation - 写入max个随机key形成多层后，
+    // 用一定不存在的key探测: 统计每次零结果GET中filter误判(需读sst)的次数，
+    // 以及全部filter占用的内存
+    void measure_filter_allocation(const std::string &name,
+                                   FilterAllocation allocation,
+                                   bool lastLevelFilter, uint64_t max) {
+        const uint64_t queryNum = 100000;
+        ScratchDir scratch("./data_filter");
+        KVStoreOptions options;
+        options.filterAllocation = allocation;
+        options.lastLevelFilter = lastLevelFilter;
+        // 写入的key均为奇数，探测用偶数key
+        loadRandomKeys(scratch, options, max, "v",
+                       [](uint64_t, uint64_t key) { return key | 1; });
+        {
+            KVStore filterStore(scratch.dir, scratch.vlog, options);
+            uint64_t seed = 2;
+            size_t filterBytes = 0;
+            for (auto &level : filterStore.levelCache)
+                for (auto &item : level) filterBytes += item.second.filter.byteNum();
+            uint64_t falsePositive = 0;
+            for (uint64_t i = 0; i < queryNum; ++i) {
+                uint64_t key = nextKey(seed) & ~1ULL;
+                for (auto &level : filterStore.levelCache)
+                    for (auto &item : level)
+                        if (item.second.minKey <= key &&
+                            key <= item.second.maxKey &&
+                            item.second.filter.query(key))
+                            falsePositive++;
+            }
+            std::cout << "FILTER (" << name << ", "
+                      << filterStore.levelCache.size()
+                      << " levels): Memory = " << filterBytes / 1024
+                      << " KB, False Positives per Zero-Result GET = "
+                      << double(falsePositive) / queryNum << std::endl;
+        }
+    }
+
+    // measure_sparse_scan - 写入max个随机key形成多层后，做宽度为width的短scan:
+    // 统计每次scan需要二分查找的sst数与平均耗时
+    void measure_sparse_scan(const std::string &name, double rangeBitsPerKey,
+                             uint64_t max, uint64_t width) {
+        const uint64_t queryNum = 20000;
+        ScratchDir scratch("./data_scan");
+        KVStoreOptions options;
+        options.rangeBitsPerKey = rangeBitsPerKey;
+        loadRandomKeys(scratch, options, max);
+        {
+            KVStore scanStore(scratch.dir, scratch.vlog, options);
+            uint64_t seed = 2, searched = 0, found = 0;
+            std::chrono::duration<double> duration(0);
+            std::list<std::pair<uint64_t, std::string>> result;
+            for (uint64_t i = 0; i < queryNum; ++i) {
+                uint64_t key1 = nextKey(seed), key2 = key1 + width - 1;
+                for (auto &level : scanStore.levelCache)
+                    for (auto &item : level)
+                        if (item.second.minKey <= key2 &&
+                            key1 <= item.second.maxKey &&
+                            item.second.rangeFilter.mayContain(
+                                std::max(key1, item.second.minKey),
+                                std::min(key2, item.second.maxKey)))
+                            searched++;
+                auto start = std::chrono::high_resolution_clock::now();
+                scanStore.scan(key1, key2, result);
+                auto end = std::chrono::high_resolution_clock::now();
+                duration += end - start;
+                found += result.size();
+            }
+            std::cout << "SCAN (" << name << ", width " << width
+                      << "): SSTs Searched per Scan = "
+                      << double(searched) / queryNum
+                      << ", Keys per Scan = " << double(found) / queryNum
+                      << ", Average Latency = "
+                      << duration.count() / queryNum * 1e6 << " us"
+                      << std::endl;
+        }
+    }
+
+    // measure_table_cache - 写入max个随机key后，以限定的tableCache预算重新打开，
+    // 随机GET已有key: 统计entry数组的命中率、常驻字节数与平均耗时
+    // budgetRatio为预算占全部sst entry数组的比例，0表示不限制
+    void measure_table_cache(const std::string &name, double budgetRatio,
+                             uint64_t max) {
+        const uint64_t queryNum = 20000;
+        ScratchDir scratch("./data_cache");
+        loadRandomKeys(scratch, KVStoreOptions(), max);
+        size_t sstNum = 0, entryBytes = 0;
+        {
+            KVStore countStore(scratch.dir, scratch.vlog);
+            for (auto &level : countStore.levelCache)
+                for (auto &[minKey, meta] : level) {
+                    sstNum++;
+                    entryBytes += sizeof(KVStore::sstInfoItemProps) +
+                                  meta.kvNum * SS_ENTRY_BYTENUM;
+                }
+        }
+        KVStoreOptions options;
+        options.tableCacheBytes = size_t(budgetRatio * entryBytes);
+        {
+            KVStore cacheStore(scratch.dir, scratch.vlog, options);
+            uint64_t hitBase = cacheStore.tableCache.getHitNum(),
+                     missBase = cacheStore.tableCache.getMissNum();
+            std::mt19937_64 gen(11);
+            std::vector<uint64_t> keys;
+            for (uint64_t i = 0, seed = 1; i < max; ++i)
+                keys.push_back(nextKey(seed));
+            auto start = std::chrono::high_resolution_clock::now();
+            for (uint64_t i = 0; i < queryNum; ++i)
+                cacheStore.get(keys[gen() % keys.size()]);
+            auto end = std::chrono::high_resolution_clock::now();
+            std::chrono::duration<double> duration = end - start;
+            uint64_t hit = cacheStore.tableCache.getHitNum() - hitBase,
+                     miss = cacheStore.tableCache.getMissNum() - missBase;
+            std::cout << "TABLE CACHE (" << name << ", " << sstNum
+                      << " ssts): Resident Entry KB = "
+                      << cacheStore.tableCache.getUsage() / 1024
+                      << ", Hit Rate = " << double(hit) / (hit + miss)
+                      << ", Average Latency = "
+                      << duration.count() / queryNum * 1e6 << " us"
+                      << std::endl;
+        }
+    }
+
+    // measure_sst_lookup - 写入max个随机key后重新打开，对tableCache中各sst的
+    // entry做点查(不含读value): 比较各种查找结构的耗时与每个key的常驻内存;
+    // 同一批key再直接在sst的映射上查一遍，即不在cache中的sst的点查
+    void measure_sst_lookup(const std::string &name,
+                            const KVStoreOptions &options, uint64_t max) {
+        const uint64_t queryNum = 1000000;
+        ScratchDir scratch("./data_index");
+        loadRandomKeys(scratch, options, max);
+        {
+            // 重新打开，learned index与hash index读自sst
+            KVStore indexStore(scratch.dir, scratch.vlog, options);
+            std::vector<std::shared_ptr<const KVStore::CachedSST>> tables;
+            std::vector<std::shared_ptr<const KVStore::sstInfoItemProps>> items;
+            std::vector<const SSTReader *> readers;
+            size_t segNum = 0, keyNum = 0, hashNum = 0;
+            for (size_t level = 0; level < indexStore.levelCache.size(); ++level)
+                for (auto &item : indexStore.levelCache[level]) {
+                    items.push_back(indexStore.loadSST(level, item.second));
+                    tables.push_back(indexStore.tableCache.lookup(item.second.uid));
+                    readers.push_back(item.second.reader.get());
+                    segNum += items.back()->learnedIndex.segments.size();
+                    keyNum += item.second.kvNum;
+                    hashNum += !items.back()->hashIndex.empty();
+                }
+            std::mt19937_64 gen(13);
+            std::vector<std::pair<size_t, KEY_TL>> queries;
+            for (uint64_t i = 0; i < queryNum; ++i) {
+                size_t t = gen() % items.size();
+                queries.emplace_back(t,
+                                     items[t]->keyList[gen() % items[t]->kvNum]);
+            }
+            uint64_t found = 0;
+            auto start = std::chrono::high_resolution_clock::now();
+            for (auto &query : queries)
+                found += indexStore
+                             .findOffsetInCachedSST(*tables[query.first],
+                                                    query.second)
+                             .offset != CONVENTIONAL_MISS_FLAG_OFFSET;
+            auto end = std::chrono::high_resolution_clock::now();
+            std::chrono::duration<double, std::nano> duration = end - start;
+            uint64_t mappedFound = 0;
+            auto mappedStart = std::chrono::high_resolution_clock::now();
+            for (auto &query : queries)
+                mappedFound += indexStore
+                                   .findOffsetInSSTReader(*readers[query.first],
+                                                          query.second)
+                                   .offset != CONVENTIONAL_MISS_FLAG_OFFSET;
+            std::chrono::duration<double, std::nano> mappedDuration =
+                std::chrono::high_resolution_clock::now() - mappedStart;
+            std::cout << "SST LOOKUP (" << name << ", " << tables.size()
+                      << " ssts): Segments per SST = "
+                      << double(segNum) / tables.size()
+                      << ", Hash Indexed SSTs = " << hashNum << ", Resident = "
+                      << double(indexStore.tableCache.getUsage()) / keyNum
+                      << " B/key, Found = " << found << "/" << queryNum
+                      << ", Average Latency = " << duration.count() / queryNum
+                      << " ns, Mapped Latency = "
+                      << mappedDuration.count() / queryNum << " ns"
+                      << std::endl;
+            // 查询的key都取自sst本身，任何一种查找结构漏查都是错误
+            assert(found == queryNum && mappedFound == queryNum);
+        }
+    }
+
+    // measure_vlog_compression - 写入max个JSON风格的value，比较vlog大小、
+    // PUT/GET平均耗时，以及GC回收全部旧版本的耗时
+    void measure_vlog_compression(const std::string &name,
+                                  VlogCompression compression, uint64_t max) {
+        const uint64_t queryNum = 20000;
+        ScratchDir scratch("./data_vlog");
+        KVStoreOptions options;
+        options.vlogCompression = compression;
+        {
+            KVStore vlogStore(scratch.dir, scratch.vlog, options);
+            std::mt19937_64 gen(17);
+            std::vector<std::string> values;
+            for (uint64_t i = 0; i < max; ++i) {
+                std::string value = "[";
+                for (int j = 0; j < 4; ++j)
+                    value += "{\"id\":" + std::to_string(i) +
+                             ",\"name\":\"user" + std::to_string(gen() % 100) +
+                             "\",\"active\":true,\"score\":" +
+                             std::to_string(gen() % 1000) + "},";
+                value.back() = ']';
+                values.push_back(std::move(value));
+            }
+            uint64_t rawBytes = 0;
+            auto start = std::chrono::high_resolution_clock::now();
+            for (uint64_t i = 0; i < max; ++i) {
+                vlogStore.put(i, values[i]);
+                rawBytes += values[i].size();
+            }
+            auto end = std::chrono::high_resolution_clock::now();
+            std::chrono::duration<double> putDuration = end - start;
+            uint64_t vlogBytes = vlogStore.getHead();
+            start = std::chrono::high_resolution_clock::now();
+            for (uint64_t i = 0; i < queryNum; ++i) vlogStore.get(gen() % max);
+            end = std::chrono::high_resolution_clock::now();
+            std::chrono::duration<double> getDuration = end - start;
+            // 全部覆盖写一遍后GC第一轮写入的部分
+            for (uint64_t i = 0; i < max; ++i) vlogStore.put(i, values[i]);
+            start = std::chrono::high_resolution_clock::now();
+            vlogStore.gc(vlogBytes);
+            end = std::chrono::high_resolution_clock::now();
+            std::chrono::duration<double> gcDuration = end - start;
+            std::cout << "VLOG (" << name << "): Raw KB = " << rawBytes / 1024
+                      << ", Vlog KB = " << vlogBytes / 1024
+                      << ", PUT Latency = " << putDuration.count() / max * 1e6
+                      << " us, GET Latency = "
+                      << getDuration.count() / queryNum * 1e6
+                      << " us, GC Time = " << gcDuration.count() * 1e3 << " ms"
+                      << std::endl;
+        }
+    }
+
+    // measure_sst_sizing - 以给定的memTable与sst大小写入max个随机key，
+    // 统计写入吞吐、sst个数与层数
+    void measure_sst_sizing(const std::string &name,
+                            const KVStoreOptions &options, uint64_t max) {
+        ScratchDir scratch("./data_sizing");
+        {
+            KVStore sizingStore(scratch.dir, scratch.vlog, options);
+            auto start = std::chrono::high_resolution_clock::now();
+            for (uint64_t i = 0, seed = 1; i < max; ++i)
+                sizingStore.put(nextKey(seed), std::string(16, 's'));
+            auto end = std::chrono::high_resolution_clock::now();
+            std::chrono::duration<double> duration = end - start;
+            size_t sstNum = 0;
+            for (auto &level : sizingStore.levelCache) sstNum += level.size();
+            std::cout << "SST SIZING (" << name << "): Throughput = "
+                      << max / duration.count() << " ops/s, SSTs = " << sstNum
+                      << ", Levels = " << sizingStore.levelCache.size()
+                      << std::endl;
+        }
+    }
+
+    // measure_sst_size - 比较sst中entry部分(data block与index block)的大小
+    // 与旧格式每个entry定长SS_ENTRY_BYTENUM字节时的大小
+    void measure_sst_size(const std::string &name, bool dense, uint64_t max) {
+        ScratchDir scratch("./data_size");
+        loadRandomKeys(scratch, KVStoreOptions(), max, std::string(64, 's'),
+                       [dense](uint64_t i, uint64_t key) {
+                           return dense ? i : key;
+                       });
+        {
+            KVStore sizeStore(scratch.dir, scratch.vlog);
+            uint64_t entryNum = 0, entryBytes = 0;
+            for (size_t level = 0; level < sizeStore.levelCache.size(); ++level) {
+                std::string levelDir = scratch.dir +
+                                       SS_DIR_PATH_SUFFIX_WITHOUT_LEVELNUM +
+                                       std::to_string(level);
+                std::vector<std::string> fileNames;
+                utils::scanDir(levelDir, fileNames);
+                for (auto &fileName : fileNames) {
+                    SSTReader reader;
+                    if (!reader.open(levelDir + "/" + fileName) ||
+                        !reader.isBlockFormat())
+                        continue;
+                    entryNum += reader.kvNum;
+                    entryBytes +=
+                        reader.getFooter().filterOffset - SS_HEADER_BYTENUM;
+                }
+            }
+            std::cout << "SST SIZE (" << name << ", " << entryNum
+                      << " entries): Entry Bytes per Key = "
+                      << double(entryBytes) / entryNum << " (flat format "
+                      << SS_ENTRY_BYTENUM << ")" << std::endl;
+        }
     }
 
    public:
@@ -201,6 +655,13 @@ class SpeedTest : public Test {
         std::cout << "[GET Test]" << std::endl;
         measure_get(TEST_MAX);
 
+        std::cout << "[Concurrent PUT/GET Test]" << std::endl;
+        unsigned maxThreads = std::max(4u, std::thread::hardware_concurrency());
+        for (unsigned threadNum = 1; threadNum <= maxThreads; threadNum *= 2) {
+            store.reset();
+            measure_concurrent(threadNum, TEST_MAX * 10);
+        }
+
         // store.reset();
 
         // std::cout << "[DEL Test]" << std::endl;
@@ -227,12 +688,83 @@ class SpeedTest : public Test {
         // std::cout << "[GET Test - Bloom Filter + Index Cache]" << std::endl;
         // measure_get_bloom_filter_cache(TEST_MAX);
 
-        // std::cout << "KVStore Speed Test (3)" << std::endl;
+        std::cout << "[WAL Sync Mode Test]" << std::endl;
+        for (unsigned threadNum : {1u, 8u}) {
+            measure_wal_sync("sync=none", WalSyncMode::NONE, threadNum,
+                             TEST_MAX);
+            measure_wal_sync("sync=interval", WalSyncMode::INTERVAL, threadNum,
+                             TEST_MAX);
+            measure_wal_sync("sync=batch", WalSyncMode::BATCH, threadNum,
+                             TEST_MAX / 10);
+        }
 
-        // store.reset();
+        std::cout << "[FLUSH Test]" << std::endl;
+        measure_flush(TEST_TINY);
+
+        std::cout << "[Compaction Test]" << std::endl;
+        measure_compaction(TEST_MAX * 10);
+
+        std::cout << "[Filter Allocation Test]" << std::endl;
+        measure_filter_allocation("uniform", FilterAllocation::UNIFORM, true,
+                                  TEST_MAX * 10);
+        measure_filter_allocation("monkey", FilterAllocation::MONKEY, true,
+                                  TEST_MAX * 10);
+        measure_filter_allocation("monkey, no last level",
+                                  FilterAllocation::MONKEY, false,
+                                  TEST_MAX * 10);
+
+        std::cout << "[Table Cache Test]" << std::endl;
+        measure_table_cache("unbounded", 0, TEST_MAX * 10);
+        measure_table_cache("budget 25%", 0.25, TEST_MAX * 10);
+        measure_table_cache("budget 5%", 0.05, TEST_MAX * 10);
+
+        std::cout << "[SST Lookup Test]" << std::endl;
+        KVStoreOptions lookupOptions;
+        measure_sst_lookup("binary search", lookupOptions, TEST_MAX * 10);
+        lookupOptions.learnedIndex = true;
+        measure_sst_lookup("learned index", lookupOptions, TEST_MAX * 10);
+        lookupOptions.learnedIndex = false;
+        lookupOptions.keyLayout = KeyLayout::EYTZINGER;
+        measure_sst_lookup("eytzinger", lookupOptions, TEST_MAX * 10);
+        lookupOptions.keyLayout = KeyLayout::SUCCINCT;
+        measure_sst_lookup("succinct", lookupOptions, TEST_MAX * 10);
+        lookupOptions.keyLayout = KeyLayout::SORTED;
+        lookupOptions.hashIndexLevels = ~0ULL;
+        measure_sst_lookup("hash index", lookupOptions, TEST_MAX * 10);
+
+        std::cout << "[Vlog Compression Test]" << std::endl;
+        measure_vlog_compression("none", VlogCompression::NONE, TEST_MAX * 2);
+        measure_vlog_compression("lz", VlogCompression::LZ, TEST_MAX * 2);
+        measure_vlog_compression("zstd", VlogCompression::ZSTD, TEST_MAX * 2);
+
+        std::cout << "[SST Size Test]" << std::endl;
+        measure_sst_size("dense keys", true, TEST_MAX * 2);
+        measure_sst_size("sparse keys", false, TEST_MAX * 2);
+
+        std::cout << "[SST Sizing Test]" << std::endl;
+        KVStoreOptions sizingOptions;
+        measure_sst_sizing("default", sizingOptions, TEST_MAX * 10);
+        sizingOptions.memTableBytes = 64 * sizingOptions.memTableBytes;
+        sizingOptions.sstTargetBytes = 8 * sizingOptions.sstTargetBytes;
+        sizingOptions.level0FileNum = 8;
+        sizingOptions.levelSizeRatio = 10;
+        measure_sst_sizing("memtable x64, sst x8", sizingOptions,
+                           TEST_MAX * 10);
+
+        std::cout << "[Sparse SCAN Test]" << std::endl;
+        // 48位key空间中放TEST_MAX * 10个key，平均间隔约2^48 / 10^5
+        for (uint64_t width : {1ULL << 28, 1ULL << 32}) {
+            measure_sparse_scan("no range filter", 0, TEST_MAX * 10, width);
+            measure_sparse_scan("range filter", DEFAULT_BITS_PER_KEY,
+                                TEST_MAX * 10, width);
+        }
+
+        std::cout << "KVStore Speed Test (3)" << std::endl;
+
+        store.reset();
 
-        // std::cout << "[PUT Test with Compaction]" << std::endl;
-        // measure_put_with_compaction(TEST_MAX);
+        std::cout << "[PUT Test with Compaction]" << std::endl;
+        measure_put_with_compaction(TEST_MAX);
     }
 };
 
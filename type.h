@@ -2,8 +2,28 @@
 #include <string>
 
 // BloomFilter
-#define DEFAULT_HASHFUN_NUM 1
-#define DEFAULT_M_VAL 4096
+#define DEFAULT_BITS_PER_KEY 10
+#define BF_MAX_HASHFUN_NUM 30
+#define BF_WORD_BITNUM 64
+#define BLOCKED_BF_BLOCK_BITNUM 256
+#define BLOCKED_BF_HASHFUN_NUM 8
+#define CACHE_LINE_BYTENUM 64
+// XorFilter: 槽位数 = 1.23 * keyNum + 32
+#define XOR_FILTER_SLOT_FACTOR 1.23
+#define XOR_FILTER_EXTRA_SLOTNUM 32
+// RangeFilter: 前缀桶约为key平均间隔的1/16，单次查询最多探测32个前缀
+#define RANGE_FILTER_SHIFT_MARGIN 4
+#define RANGE_FILTER_MAX_PROBENUM 32
+// LearnedIndex: 段内预测下标误差不超过8，局部二分约4次比较
+#define LEARNED_INDEX_EPSILON 8
+#define LEARNED_INDEX_SEGMENT_BYTENUM 20  // firstKey(u64) + slope(f64) + firstPos(u32)
+// EytzingerIndex: 预取3层之后的8个后代节点(8 * 8B = 64B)
+#define EYTZINGER_PREFETCH_LEVEL 3
+// EliasFano: 每64个1(或0)记录一次位置，select最多扫描约两个word
+#define ELIAS_FANO_SELECT_SAMPLE 64
+// HashIndex: 装载率不超过0.75，命中时平均约1.5次探测
+#define HASH_INDEX_LOAD_FACTOR 0.75
+#define HASH_INDEX_MAGIC 0x58444948  // "HIDX"
 
 // KVStore
 typedef uint64_t KEY_TL;  // TL means 'type for LSM'
@@ -18,24 +38,55 @@ typedef uint64_t SST_HEADER_KVNUM_TL;
 typedef int SST_LEVEL_TL;
 
 #define SS_HEADER_BYTENUM 32
-#define SS_BLOOM_BYTENUM (DEFAULT_M_VAL / 8)
 #define SS_KEY_BYTENUM sizeof(KEY_TL)
 #define SS_OFFSET_BYTENUM sizeof(SS_OFFSET_TL)
 #define SS_VLEN_BYTENUM sizeof(SS_VLEN_TL)
+// filter位于entry(index block)之后: [type(u8)|该类型filter的内容][range filter]
+#define SS_FILTER_TYPE_BYTENUM 1
 #define SS_MAX_FILE_BYTENUM 16384  // 16 * 1024
+// block格式(见sstblock.h)，footer中的magic用于与旧的定长entry格式区分
+// version 2的footer多存vlogEnd，打开sst时不必解码entry即可得到vlog的重放起点
+#define SS_FORMAT_VERSION 2
+#define SS_FOOTER_MAGIC 0x4c534d42  // "BMSL"
+#define SS_FOOTER_BYTENUM 32
+#define SS_FOOTER_V1_BYTENUM 24
+#define SS_BLOCK_BYTENUM 4096
+#define SS_BLOCK_RESTART_INTERVAL 16
+#define SS_INDEX_ENTRY_BYTENUM 16  // lastKey(u64) + offset(u32) + bytes(u32)
 #define SS_TIMESTAMP_BYTENUM sizeof(SS_TIMESTAMP_TL)
 #define SS_KVNUM_BYTENUM sizeof(SST_HEADER_KVNUM_TL)
 #define VLOG_MAGIC_BYTENUM sizeof(VLOG_MAGIC_TL)
 #define VLOG_CHECKSUM_BYTENUM sizeof(VLOG_CHECKSUM_TL)
+#define VLOG_ENTRY_HEADER_BYTENUM                                \
+    (VLOG_MAGIC_BYTENUM + VLOG_CHECKSUM_BYTENUM + SS_KEY_BYTENUM + \
+     SS_VLEN_BYTENUM)
 #define SS_FILE_SUFFIX ".sst"
+// sst先写成"<uid>.sst.tmp"，写完后再rename
+#define SS_TMP_FILE_SUFFIX ".tmp"
+// 旧格式(无footer)的sst: [header|固定512B的bloom|kvNum个定长entry]
+#define SS_LEGACY_BLOOM_BYTENUM 512
+#define LEGACY_BF_BITNUM (SS_LEGACY_BLOOM_BYTENUM * 8)
 #define VLOG_DEFAULT_MAGIC_VAL 0xff
+// magic去掉该位表示value经过压缩，格式见vlogcodec.h
+#define VLOG_COMPRESSED_FLAG 0x01
+#define VLOG_COMPRESSED_MAGIC_VAL (VLOG_DEFAULT_MAGIC_VAL & ~VLOG_COMPRESSED_FLAG)
+#define IS_VLOG_MAGIC(magic) \
+    (((magic) | VLOG_COMPRESSED_FLAG) == VLOG_DEFAULT_MAGIC_VAL)
+// 短于此长度的value不尝试压缩
+#define VLOG_COMPRESS_MIN_BYTENUM 32
+#define VLOG_MAX_RAW_BYTENUM UINT32_MAX
+#define VLOG_CODEC_HEADER_MAX_BYTENUM 11  // codec(u8) + varint(u64)原长
+#define VLOG_LZ_MIN_MATCH 4
+#define VLOG_LZ_MAX_HASH_BITS 12
+#define VLOG_ZSTD_LEVEL 1
 #define SS_DIR_PATH_SUFFIX_WITHOUT_LEVELNUM "/level-"
-#define MAX_SST_KV_GROUP_NUM 792  // actually same as memTableLenThreshold
+// 16KB扣除header与原先固定512B的bloom后可容纳的entry数;
+// 旧格式sst的entry数上限，也是memTable与sst的默认entry数
+#define MAX_SST_KV_GROUP_NUM 792
 #define MAX_CACHE_ENTRIES 1000000
 #define SS_ENTRY_BYTENUM (SS_KEY_BYTENUM + SS_OFFSET_BYTENUM + SS_VLEN_BYTENUM)
 #define DELETE_MARK "~DELETED~"
 #define CONVENTIONAL_MISS_FLAG_OFFSET 1
-#define MAX_FILE_NUM_GIVEN_LEVEL(level) ((FILE_NUM_TL)1 << (level + 1))
 #define WATCHED_KEY 0
 #define WATCHED_GC_KEY 0
 #define WATCHED_FILEUID 0
\ No newline at end of file
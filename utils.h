@@ -92,6 +92,18 @@ static inline bool dirExists(const std::string &path) {
         return ::rmdir(path.c_str());
     }
 
+    /**
+     * Check whether a string ends with the given suffix
+     * @param str string to be checked.
+     * @param suffix expected suffix.
+     * @return true if str ends with suffix, false otherwise.
+     */
+    static inline bool endsWith(const std::string &str, const std::string &suffix)
+    {
+        return str.size() >= suffix.size() &&
+               str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
     /**
      * Delete a file
      * @param path file to be deleted.
@@ -0,0 +1,139 @@
+#include "vector_memtable.h"
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+
+namespace skiplist {
+// 同一key按offset升序，去重时保留最后(offset最大)的一个
+static bool entryLess(const std::pair<key_type, VlogPointer> &a,
+                      const std::pair<key_type, VlogPointer> &b) {
+    if (a.first != b.first) return a.first < b.first;
+    return a.second.offset < b.second.offset;
+}
+size_t vector_memtable_type::tailLimit() const {
+    return std::max<size_t>(VECTOR_MEMTABLE_MIN_TAIL_NUM,
+                            size_t(std::sqrt(double(sortedEnd))));
+}
+void vector_memtable_type::mergeTailLocked() const {
+    if (sortedEnd == entries.size()) return;
+    std::sort(entries.begin() + sortedEnd, entries.end(), entryLess);
+    std::inplace_merge(entries.begin(), entries.begin() + sortedEnd,
+                       entries.end(), entryLess);
+    size_t last = 0;
+    for (size_t i = 1; i < entries.size(); i++) {
+        if (entries[i].first != entries[last].first) last++;
+        entries[last] = entries[i];
+    }
+    if (!entries.empty()) entries.resize(last + 1);
+    sortedEnd = entries.size();
+}
+std::optional<VlogPointer> vector_memtable_type::findLocked(
+    key_type key) const {
+    std::optional<VlogPointer> res;
+    auto end = entries.begin() + sortedEnd;
+    auto it = std::lower_bound(
+        entries.begin(), end, key,
+        [](const auto &entry, key_type k) { return entry.first < k; });
+    if (it != end && it->first == key) res = it->second;
+    for (size_t i = sortedEnd; i < entries.size(); i++)
+        if (entries[i].first == key &&
+            (!res || res->offset < entries[i].second.offset))
+            res = entries[i].second;
+    return res;
+}
+int vector_memtable_type::getLength() {
+    std::shared_lock<std::shared_mutex> lock(vectorMutex);
+    return entries.size();
+}
+void vector_memtable_type::put(key_type key, const VlogPointer &val) {
+    std::unique_lock<std::shared_mutex> lock(vectorMutex);
+    if (sortedEnd == entries.size()) {
+        if (entries.empty() || key > entries.back().first) {
+            // 递增key直接延长有序区
+            entries.emplace_back(key, val);
+            sortedEnd++;
+            return;
+        }
+        if (key == entries.back().first) {
+            // 连续写同一key，原地覆盖
+            if (entries.back().second.offset < val.offset)
+                entries.back().second = val;
+            return;
+        }
+    }
+    entries.emplace_back(key, val);
+}
+void vector_memtable_type::lockForRead(
+    std::shared_lock<std::shared_mutex> &lock) const {
+    lock = std::shared_lock<std::shared_mutex>(vectorMutex);
+    if (entries.size() - sortedEnd <= tailLimit()) return;
+    lock.unlock();
+    {
+        std::unique_lock<std::shared_mutex> uniqueLock(vectorMutex);
+        mergeTailLocked();
+    }
+    // 重新加共享锁期间可能又有put追加，乱序区略超上限不影响正确性
+    lock.lock();
+}
+std::optional<VlogPointer> vector_memtable_type::get(key_type key) const {
+    std::shared_lock<std::shared_mutex> lock;
+    lockForRead(lock);
+    return findLocked(key);
+}
+void vector_memtable_type::scan(
+    uint64_t key1, uint64_t key2,
+    std::list<std::pair<uint64_t, VlogPointer>> &list) {
+    std::shared_lock<std::shared_mutex> lock;
+    lockForRead(lock);
+    // 有序区的区间与乱序区中落在区间内的entry归并后去重
+    auto end = entries.begin() + sortedEnd;
+    auto it = std::lower_bound(
+        entries.begin(), end, key1,
+        [](const auto &entry, key_type k) { return entry.first < k; });
+    std::vector<std::pair<key_type, VlogPointer>> hits;
+    for (; it != end && it->first <= key2; ++it) hits.push_back(*it);
+    size_t runNum = hits.size();
+    for (size_t i = sortedEnd; i < entries.size(); i++)
+        if (entries[i].first >= key1 && entries[i].first <= key2)
+            hits.push_back(entries[i]);
+    if (hits.size() != runNum) {
+        std::sort(hits.begin() + runNum, hits.end(), entryLess);
+        std::inplace_merge(hits.begin(), hits.begin() + runNum, hits.end(),
+                           entryLess);
+    }
+    for (size_t i = 0; i < hits.size(); i++)
+        if (i + 1 == hits.size() || hits[i + 1].first != hits[i].first)
+            list.emplace_back(hits[i].first, hits[i].second);
+}
+size_t vector_memtable_type::memoryUsage() const {
+    std::shared_lock<std::shared_mutex> lock(vectorMutex);
+    return entries.capacity() * sizeof(entries[0]);
+}
+void vector_memtable_type::seal() {
+    std::unique_lock<std::shared_mutex> lock(vectorMutex);
+    mergeTailLocked();
+}
+// VectorIterator - seal后entries已有序且无重复，直接顺序访问
+class VectorIterator : public memtable_type::Iterator {
+   private:
+    const std::vector<std::pair<key_type, VlogPointer>> &entries;
+    size_t pos = 0;
+
+   public:
+    explicit VectorIterator(
+        const std::vector<std::pair<key_type, VlogPointer>> &_entries)
+        : entries(_entries) {}
+    bool valid() const override { return pos < entries.size(); }
+    void next() override { pos++; }
+    key_type key() const override { return entries[pos].first; }
+    VlogPointer value() const override { return entries[pos].second; }
+};
+std::unique_ptr<memtable_type::Iterator> vector_memtable_type::newIterator()
+    const {
+    std::unique_lock<std::shared_mutex> lock(vectorMutex);
+    mergeTailLocked();
+    return std::make_unique<VectorIterator>(entries);
+}
+
+}  // namespace skiplist
@@ -0,0 +1,53 @@
+#ifndef VECTOR_MEMTABLE_H
+#define VECTOR_MEMTABLE_H
+
+#include <cstdint>
+#include <list>
+#include <optional>
+#include <shared_mutex>
+#include <utility>
+#include <vector>
+
+#include "memtable.h"
+
+// 乱序区的长度上限取max(该值, sqrt(有序区长度))，读操作线性扫描的代价随之受限
+#define VECTOR_MEMTABLE_MIN_TAIL_NUM 64
+
+namespace skiplist {
+
+// vector_memtable_type - 追加写的vector，面向批量导入
+// entries[0, sortedEnd)为有序且去重的有序区，其后为按写入顺序追加的乱序区
+// put为O(1): key递增时延长有序区，乱序key追加到乱序区，批量导入不做任何排序
+// get/scan持共享锁，有序区二分、乱序区线性扫描; 只有乱序区超过上限时才短暂
+// 取独占锁，将乱序区排序后归并进有序区，交替put/get时该代价按上限摊还
+class vector_memtable_type : public memtable_type {
+   private:
+    mutable std::vector<std::pair<key_type, VlogPointer>> entries;
+    mutable size_t sortedEnd = 0;
+    mutable std::shared_mutex vectorMutex;
+
+    size_t tailLimit() const;
+    // mergeTailLocked - 调用者需持有vectorMutex的独占锁
+    void mergeTailLocked() const;
+    // lockForRead - 加共享锁，乱序区超过上限时先在独占锁下合并
+    void lockForRead(std::shared_lock<std::shared_mutex> &lock) const;
+    // findLocked - 调用者需持有vectorMutex(共享或独占)
+    std::optional<VlogPointer> findLocked(key_type key) const;
+
+   public:
+    vector_memtable_type() = default;
+    ~vector_memtable_type() override = default;
+    // 乱序区可能包含重复key，偏大但不会偏小
+    int getLength() override;
+    void put(key_type key, const VlogPointer &val) override;
+    std::optional<VlogPointer> get(key_type key) const override;
+    void scan(uint64_t key1, uint64_t key2,
+              std::list<std::pair<uint64_t, VlogPointer>> &list) override;
+    std::unique_ptr<Iterator> newIterator() const override;
+    size_t memoryUsage() const override;
+    void seal() override;
+};
+
+}  // namespace skiplist
+
+#endif  // VECTOR_MEMTABLE_H
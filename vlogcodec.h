@@ -0,0 +1,166 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef LSM_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "options.h"
+#include "sstblock.h"
+#include "type.h"
+
+// vlog中压缩value的格式 (magic带VLOG_COMPRESSED_FLAG时):
+// [codec(u8)][varint 原长][codec数据]，vlen与checksum都针对压缩后的字节
+// LZ: 内置的LZ77，不依赖外部库，sequence依次为
+//   [token(u8): 高4位literal长度，低4位match长度-VLOG_LZ_MIN_MATCH][literal]
+//   [distance(u16)]，长度达到15时其后另接varint余量; 最后一个sequence只有literal
+// ZSTD: 编译时找到zstd.h才可用(LSM_HAVE_ZSTD)，否则退回LZ
+
+namespace vlogcodec {
+
+enum Codec : uint8_t {
+    CODEC_LZ = 1,
+    CODEC_ZSTD = 2,
+};
+
+inline uint32_t load32(const char *p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+// putLength - token中的4位长度满15时，余量以varint接在后面
+inline void putLength(std::string &out, size_t len) {
+    if (len >= 15) sstblock::putVarint(out, len - 15);
+}
+inline bool getLength(const char *&p, const char *end, size_t &len) {
+    if (len < 15) return true;
+    uint64_t extra;
+    if (!sstblock::getVarint(p, end, extra)) return false;
+    len += extra;
+    return true;
+}
+inline void putSequence(std::string &out, const char *literal, size_t litLen,
+                        size_t matchLen, size_t distance) {
+    size_t matchCode = matchLen ? matchLen - VLOG_LZ_MIN_MATCH : 0;
+    out.push_back(char((std::min<size_t>(litLen, 15) << 4) |
+                       std::min<size_t>(matchCode, 15)));
+    putLength(out, litLen);
+    out.append(literal, litLen);
+    if (!matchLen) return;
+    out.push_back(char(distance & 0xff));
+    out.push_back(char(distance >> 8));
+    putLength(out, matchCode);
+}
+
+// lzCompress - 以4字节的哈希找最近一次出现的位置，贪心地取最长匹配
+inline void lzCompress(const char *src, size_t n, std::string &out) {
+    int hashBits = 8;
+    while (hashBits < VLOG_LZ_MAX_HASH_BITS && (size_t(1) << hashBits) < n)
+        hashBits++;
+    std::vector<uint32_t> table(size_t(1) << hashBits, UINT32_MAX);
+    auto hash = [hashBits](uint32_t v) {
+        return (v * 2654435761u) >> (32 - hashBits);
+    };
+    size_t anchor = 0, i = 0;
+    while (i + VLOG_LZ_MIN_MATCH <= n) {
+        uint32_t v = load32(src + i);
+        uint32_t &slot = table[hash(v)];
+        size_t candidate = slot;
+        slot = uint32_t(i);
+        if (candidate == UINT32_MAX || i - candidate > UINT16_MAX ||
+            load32(src + candidate) != v) {
+            i++;
+            continue;
+        }
+        size_t len = VLOG_LZ_MIN_MATCH;
+        while (i + len < n && src[candidate + len] == src[i + len]) len++;
+        putSequence(out, src + anchor, i - anchor, len, i - candidate);
+        i += len;
+        anchor = i;
+    }
+    putSequence(out, src + anchor, n - anchor, 0, 0);
+}
+// lzDecompress - 输入损坏时返回false，不越界读写
+inline bool lzDecompress(const char *p, const char *end, size_t rawLen,
+                         std::string &out) {
+    out.resize(rawLen);
+    size_t op = 0;
+    while (p < end) {
+        uint8_t token = uint8_t(*p++);
+        size_t litLen = token >> 4, matchLen = token & 0xf;
+        if (!getLength(p, end, litLen) || litLen > size_t(end - p) ||
+            litLen > rawLen - op)
+            return false;
+        std::memcpy(&out[op], p, litLen);
+        p += litLen, op += litLen;
+        if (p == end) break;
+        if (end - p < 2) return false;
+        size_t distance = uint8_t(p[0]) | size_t(uint8_t(p[1])) << 8;
+        p += 2;
+        if (!getLength(p, end, matchLen)) return false;
+        matchLen += VLOG_LZ_MIN_MATCH;
+        if (!distance || distance > op || matchLen > rawLen - op) return false;
+        // 匹配可能与输出重叠(distance < matchLen)，须逐字节复制
+        for (size_t k = 0; k < matchLen; k++, op++) out[op] = out[op - distance];
+    }
+    return op == rawLen;
+}
+
+// compress - 压缩后不小于原长时返回false，调用者应原样写入
+inline bool compress(VlogCompression type, const std::string &raw,
+                     std::string &out) {
+    if (type == VlogCompression::NONE) return false;
+    out.clear();
+#ifdef LSM_HAVE_ZSTD
+    if (type == VlogCompression::ZSTD) {
+        out.push_back(char(CODEC_ZSTD));
+        sstblock::putVarint(out, raw.size());
+        size_t headerBytes = out.size();
+        out.resize(headerBytes + ZSTD_compressBound(raw.size()));
+        size_t n = ZSTD_compress(&out[headerBytes], out.size() - headerBytes,
+                                 raw.data(), raw.size(), VLOG_ZSTD_LEVEL);
+        if (ZSTD_isError(n)) return false;
+        out.resize(headerBytes + n);
+        return out.size() < raw.size();
+    }
+#endif
+    out.push_back(char(CODEC_LZ));
+    sstblock::putVarint(out, raw.size());
+    lzCompress(raw.data(), raw.size(), out);
+    return out.size() < raw.size();
+}
+// rawLength - 只解析[codec][varint 原长]，不解压; p最多需VLOG_CODEC_HEADER_MAX_BYTENUM字节
+inline bool rawLength(const char *p, size_t n, uint64_t &rawLen) {
+    const char *end = p + n;
+    if (p == end) return false;
+    p++;
+    return sstblock::getVarint(p, end, rawLen) && rawLen <= VLOG_MAX_RAW_BYTENUM;
+}
+inline bool decompress(const char *p, size_t n, std::string &out) {
+    const char *end = p + n;
+    if (p == end) return false;
+    uint8_t codec = uint8_t(*p++);
+    uint64_t rawLen;
+    if (!sstblock::getVarint(p, end, rawLen) || rawLen > VLOG_MAX_RAW_BYTENUM)
+        return false;
+    switch (codec) {
+        case CODEC_LZ:
+            return lzDecompress(p, end, rawLen, out);
+#ifdef LSM_HAVE_ZSTD
+        case CODEC_ZSTD: {
+            out.resize(rawLen);
+            size_t got = ZSTD_decompress(out.data(), rawLen, p, end - p);
+            return !ZSTD_isError(got) && got == rawLen;
+        }
+#endif
+        default:
+            return false;
+    }
+}
+
+}  // namespace vlogcodec
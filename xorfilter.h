@@ -0,0 +1,131 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#include "MurmurHash3.h"
+#include "type.h"
+
+// XorFilter - xor filter，只能对一组固定的key一次性构建，之后不可插入
+// 槽位分成3段，每个key在每段各映射一个槽位，三个槽位上8位指纹的异或
+// 等于key自身的指纹; 误判率约1/256，每个key约占 8 * 1.23 = 9.84 bit，
+// 同样误判率下BF需要约11.5 bit/key
+class XorFilter {
+   private:
+    static uint64_t getHashValue(const uint64_t& key, uint32_t seed) {
+        uint64_t hashRes[2];
+        MurmurHash3_x64_128(&key, sizeof(key), seed, hashRes);
+        return hashRes[0];
+    }
+    static uint8_t fingerprint(uint64_t h) { return uint8_t(h ^ (h >> 32)); }
+    // reduce - 把32位hash映射到[0, n)，用乘法代替取模
+    static uint32_t reduce(uint32_t h, uint32_t n) {
+        return uint32_t((uint64_t(h) * n) >> 32);
+    }
+    void slotsOf(uint64_t h, uint32_t slots[3]) const {
+        slots[0] = reduce(uint32_t(h), blockLength);
+        slots[1] = reduce(uint32_t((h << 21) | (h >> 43)), blockLength) +
+                   blockLength;
+        slots[2] = reduce(uint32_t((h << 42) | (h >> 22)), blockLength) +
+                   2 * blockLength;
+    }
+
+   public:
+    uint32_t seed;
+    uint32_t blockLength;               // 每段的槽位数
+    std::vector<uint8_t> fingerprints;  // 3 * blockLength 个槽位，构建时使用
+    // 从sst读出时直接指向映射中的fingerprints，不拷贝; 映射须比filter活得久
+    const uint8_t* view = nullptr;
+    // 空filter: 不含任何信息，query总是返回true
+    XorFilter() : seed(0), blockLength(0) {}
+    // 构建: 反复摘除只被一个key占用的槽位(peeling)，再按摘除的逆序填指纹;
+    // 小概率失败(出现环)，此时换seed重试
+    XorFilter(const uint64_t* keys, size_t keyNum) : seed(0) {
+        // 重复的key会使peeling永远失败
+        std::vector<uint64_t> keySet(keys, keys + keyNum);
+        std::sort(keySet.begin(), keySet.end());
+        keySet.erase(std::unique(keySet.begin(), keySet.end()), keySet.end());
+
+        size_t capacity = XOR_FILTER_EXTRA_SLOTNUM +
+                          size_t(std::ceil(XOR_FILTER_SLOT_FACTOR * keySet.size()));
+        blockLength = uint32_t(capacity / 3);
+        size_t slotNum = size_t(blockLength) * 3;
+        std::vector<uint32_t> count(slotNum);
+        std::vector<uint64_t> xorMask(slotNum);  // 占用该槽位的key的hash异或
+        std::vector<uint32_t> queue;
+        std::vector<std::pair<uint64_t, uint32_t>> stack;  // (hash, 独占的槽位)
+        uint32_t slots[3];
+        for (;; seed++) {
+            std::fill(count.begin(), count.end(), 0);
+            std::fill(xorMask.begin(), xorMask.end(), 0);
+            for (uint64_t key : keySet) {
+                uint64_t h = getHashValue(key, seed);
+                slotsOf(h, slots);
+                for (uint32_t slot : slots) count[slot]++, xorMask[slot] ^= h;
+            }
+            queue.clear();
+            for (uint32_t i = 0; i < slotNum; i++)
+                if (count[i] == 1) queue.push_back(i);
+            stack.clear();
+            while (!queue.empty()) {
+                uint32_t i = queue.back();
+                queue.pop_back();
+                if (count[i] != 1) continue;
+                uint64_t h = xorMask[i];
+                stack.emplace_back(h, i);
+                slotsOf(h, slots);
+                for (uint32_t slot : slots) {
+                    count[slot]--, xorMask[slot] ^= h;
+                    if (count[slot] == 1) queue.push_back(slot);
+                }
+            }
+            if (stack.size() == keySet.size()) break;
+        }
+        fingerprints.assign(slotNum, 0);
+        for (auto it = stack.rbegin(); it != stack.rend(); ++it) {
+            slotsOf(it->first, slots);
+            // 此时fingerprints[it->second]仍为0
+            fingerprints[it->second] =
+                fingerprint(it->first) ^ fingerprints[slots[0]] ^
+                fingerprints[slots[1]] ^ fingerprints[slots[2]];
+        }
+    }
+    const uint8_t* bytes() const { return view ? view : fingerprints.data(); }
+    bool query(const uint64_t& key) const {
+        if (!blockLength) return true;
+        uint64_t h = getHashValue(key, seed);
+        uint32_t slots[3];
+        slotsOf(h, slots);
+        const uint8_t* fp = bytes();
+        return fingerprint(h) == (fp[slots[0]] ^ fp[slots[1]] ^ fp[slots[2]]);
+    }
+    size_t byteNum() const { return size_t(blockLength) * 3; }
+    // sst中的格式: [seed(u32)|blockLength(u32)|fingerprints]
+    void writeTo(std::ostream& out) const {
+        out.write(reinterpret_cast<const char*>(&seed), sizeof(seed));
+        out.write(reinterpret_cast<const char*>(&blockLength),
+                  sizeof(blockLength));
+        out.write(reinterpret_cast<const char*>(bytes()), byteNum());
+    }
+    // viewFrom - 在p处最多availBytes字节内解析，fingerprints不拷贝;
+    // 返回占用的字节数，格式不合法时返回0
+    size_t viewFrom(const char* p, size_t availBytes) {
+        if (availBytes < sizeof(seed) + sizeof(blockLength)) return 0;
+        std::memcpy(&seed, p, sizeof(seed));
+        std::memcpy(&blockLength, p + sizeof(seed), sizeof(blockLength));
+        size_t bytesNum = sizeof(seed) + sizeof(blockLength) + byteNum();
+        if (bytesNum > availBytes) {
+            seed = blockLength = 0;
+            return 0;
+        }
+        fingerprints.clear();
+        view = reinterpret_cast<const uint8_t*>(p) + sizeof(seed) +
+               sizeof(blockLength);
+        return bytesNum;
+    }
+};